@@ -0,0 +1,683 @@
+// el_bench.c: replay allocation traces against el_malloc and glibc
+// malloc and report throughput, latency percentiles, peak footprint
+// and fragmentation.
+//
+// Traces are text files with one operation per line:
+//
+//   m <id> <bytes>     allocate bytes and remember the pointer as id
+//   r <id> <bytes>     reallocate the pointer for id to bytes
+//   f <id>             free the pointer for id
+//
+// Blank lines and lines starting with # are ignored. Ids are small
+// non-negative integers naming live objects. Instead of a file a
+// synthetic trace can be generated:
+//
+//   uniform    sizes uniform in [min,max], random alloc/free/realloc
+//   powerlaw   mostly small sizes with a heavy tail of large ones
+//   prodcons   producer/consumer: objects freed in FIFO order after a
+//              lifetime window, with a few long lived objects mixed in
+//
+// usage: el_bench [options] {-t tracefile | -g generator}
+//   -a el|glibc|both   allocator(s) to run (default both)
+//   -n ops             operations to generate (default 1000000)
+//   -l live            maximum live objects for generators (default 10000)
+//   -z min,max         size range for generators (default 16,512)
+//   -s seed            random seed for generators (default 1)
+//   -H megabytes       el_malloc heap size (default 512)
+//   -w tracefile       write the trace being run to tracefile
+//   -q size,count      turn on el_malloc quick lists for blocks up to
+//                      size bytes, count per list (default off)
+//   -m bytes           fix the el_malloc mmap threshold, 0 for never
+//                      (default adaptive)
+//
+// With -b count no trace is replayed; instead el_malloc_batch() and
+// el_free_batch() of count same-sized objects at a time are compared
+// against el_malloc() and el_free() in a loop. The heap is first
+// fragmented with -l live objects and the -n ops objects are
+// allocated in batches with sizes from -z and freed in random order.
+//
+// With -A alignment el_aligned_alloc() is compared against the usual
+// workaround of asking el_malloc() for alignment-1 extra bytes and
+// rounding the pointer up. -l live buffers with sizes from -z are
+// allocated, every other one is freed and refilled, and the bytes
+// wasted per block beyond the request and block overhead are printed
+// with the footprint.
+//
+// With -r count,bytes a buffer is grown by count appends of bytes
+// each, once with el_realloc() and once by el_malloc() of the new
+// size, memcpy() and el_free() of the old buffer, and the time per
+// append is printed. A small block is allocated every 1000 appends
+// so the buffer does not always have the end of the heap above it.
+// Once the buffer passes the mmap threshold el_realloc() moves it to
+// a mapping and grows it with mremap(); -m 0 keeps it in the heap.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <malloc.h>
+#include "el_malloc.h"
+
+// one operation in a trace
+typedef struct {
+  char op;                      // 'm', 'r' or 'f'
+  int id;                       // object the operation applies to
+  size_t nbytes;                // bytes for 'm' and 'r'
+} op_t;
+
+// a whole trace along with the number of object ids it uses
+typedef struct {
+  op_t *ops;
+  size_t len;
+  size_t cap;
+  int ids;
+} trace_t;
+
+// results of replaying a trace against one allocator
+typedef struct {
+  double seconds;               // total time spent in allocator calls
+  size_t failed;                // allocations that returned NULL
+  size_t peak_footprint;        // most heap memory the allocator held
+  size_t peak_live;             // most requested bytes live at once
+  double fragmentation;         // free space fragmentation when the most bytes were live
+  long *nanos;                  // per-operation latencies
+} result_t;
+
+void trace_add(trace_t *trace, char op, int id, size_t nbytes){
+  if(trace->len == trace->cap){
+    trace->cap = trace->cap == 0 ? 4096 : 2*trace->cap;
+    trace->ops = realloc(trace->ops, trace->cap * sizeof(op_t));
+    if(trace->ops == NULL){
+      fprintf(stderr,"el_bench: out of memory for trace\n");
+      exit(1);
+    }
+  }
+  trace->ops[trace->len].op = op;
+  trace->ops[trace->len].id = id;
+  trace->ops[trace->len].nbytes = nbytes;
+  trace->len++;
+  if(id >= trace->ids){
+    trace->ids = id+1;
+  }
+}
+
+// Read a trace file in the format described at the top of the file.
+// Returns 0 on success and 1 on a malformed line.
+int trace_read(trace_t *trace, char *fname){
+  FILE *fin = fopen(fname, "r");
+  if(fin == NULL){
+    perror(fname);
+    return 1;
+  }
+  char line[256];
+  int lineno = 0;
+  while(fgets(line, sizeof(line), fin) != NULL){
+    lineno++;
+    char op;
+    int id;
+    size_t nbytes = 0;
+    if(line[0] == '#' || line[0] == '\n'){
+      continue;
+    }
+    int n = sscanf(line, " %c %d %zu", &op, &id, &nbytes);
+    if(n < 2 || id < 0 || (op != 'f' && ((op != 'm' && op != 'r') || n != 3))){
+      fprintf(stderr,"%s:%d: malformed trace line\n", fname, lineno);
+      fclose(fin);
+      return 1;
+    }
+    trace_add(trace, op, id, nbytes);
+  }
+  fclose(fin);
+  return 0;
+}
+
+void trace_write(trace_t *trace, char *fname){
+  FILE *fout = fopen(fname, "w");
+  if(fout == NULL){
+    perror(fname);
+    exit(1);
+  }
+  for(size_t i=0; i<trace->len; i++){
+    op_t *op = &trace->ops[i];
+    if(op->op == 'f'){
+      fprintf(fout, "f %d\n", op->id);
+    }
+    else{
+      fprintf(fout, "%c %d %zu\n", op->op, op->id, op->nbytes);
+    }
+  }
+  fclose(fout);
+}
+
+double rand_unit(){
+  return (rand() + 1.0) / (RAND_MAX + 2.0);
+}
+
+size_t size_uniform(size_t lo, size_t hi){
+  return lo + (size_t) (rand_unit() * (hi - lo + 1));
+}
+
+// Pareto distributed sizes with shape 1.2 starting at lo and capped
+// at hi: most requests are near lo with a heavy tail.
+size_t size_powerlaw(size_t lo, size_t hi){
+  double size = lo * pow(rand_unit(), -1.0/1.2);
+  return size > hi ? hi : (size_t) size;
+}
+
+// Random mix of allocations, frees and reallocations over at most
+// live objects. Sizes come from sizefn.
+void gen_random(trace_t *trace, size_t nops, int live, size_t lo, size_t hi,
+                size_t (*sizefn)(size_t, size_t)){
+  char *in_use = calloc(live, 1);
+  while(trace->len < nops){
+    int id = rand() % live;
+    int pct = rand() % 100;
+    if(!in_use[id]){
+      trace_add(trace, 'm', id, sizefn(lo, hi));
+      in_use[id] = 1;
+    }
+    else if(pct < 10){
+      trace_add(trace, 'r', id, sizefn(lo, hi));
+    }
+    else if(pct < 60){
+      trace_add(trace, 'f', id, 0);
+      in_use[id] = 0;
+    }
+  }
+  for(int id=0; id<live; id++){
+    if(in_use[id]){
+      trace_add(trace, 'f', id, 0);
+    }
+  }
+  free(in_use);
+}
+
+// Producer/consumer lifetimes: objects are queued and freed oldest
+// first once the queue holds live objects. One in 64 objects is long
+// lived and freed only at the end.
+void gen_prodcons(trace_t *trace, size_t nops, int live, size_t lo, size_t hi){
+  int *queue = malloc(live * sizeof(int));
+  int head = 0, count = 0;
+  int next_id = live;           // long lived ids start above the queue ids
+  int *longlived = NULL;
+  int nlong = 0;
+  int slot = 0;
+  while(trace->len < nops){
+    if(count == live){
+      trace_add(trace, 'f', queue[head], 0);
+      head = (head+1) % live;
+      count--;
+    }
+    if(rand() % 64 == 0){
+      longlived = realloc(longlived, (nlong+1) * sizeof(int));
+      longlived[nlong++] = next_id;
+      trace_add(trace, 'm', next_id++, size_uniform(lo, hi));
+      continue;
+    }
+    int id = slot;
+    slot = (slot+1) % live;
+    trace_add(trace, 'm', id, size_uniform(lo, hi));
+    queue[(head+count) % live] = id;
+    count++;
+  }
+  for(; count > 0; count--){
+    trace_add(trace, 'f', queue[head], 0);
+    head = (head+1) % live;
+  }
+  for(int i=0; i<nlong; i++){
+    trace_add(trace, 'f', longlived[i], 0);
+  }
+  free(queue);
+  free(longlived);
+}
+
+long nanos_between(struct timespec *a, struct timespec *b){
+  return (b->tv_sec - a->tv_sec) * 1000000000L + (b->tv_nsec - a->tv_nsec);
+}
+
+// Current heap footprint of glibc malloc: main arena plus mmap()'d chunks.
+size_t glibc_footprint(){
+  struct mallinfo2 info = mallinfo2();
+  return info.arena + info.hblkhd;
+}
+
+// Replay the trace against el_malloc if use_el is set, otherwise
+// against glibc malloc, filling in result.
+void replay(trace_t *trace, int use_el, result_t *result){
+  void **ptrs = calloc(trace->ids, sizeof(void *));
+  size_t *sizes = calloc(trace->ids, sizeof(size_t));
+  size_t live = 0;
+  memset(result, 0, sizeof(*result));
+  result->nanos = malloc(trace->len * sizeof(long));
+  // the bench's own arrays come from glibc too so are not counted
+  size_t baseline = use_el ? 0 : glibc_footprint();
+  size_t mapped = 0;             // most bytes el_malloc held in mappings
+  struct timespec start, end;
+  for(size_t i=0; i<trace->len; i++){
+    op_t *op = &trace->ops[i];
+    void *ptr = ptrs[op->id];
+    void *newPtr = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    switch(op->op){
+      case 'm':
+        newPtr = use_el ? el_malloc(op->nbytes) : malloc(op->nbytes);
+        break;
+      case 'r':
+        newPtr = use_el ? el_realloc(ptr, op->nbytes) : realloc(ptr, op->nbytes);
+        break;
+      case 'f':
+        if(use_el){
+          el_free(ptr);
+        }
+        else{
+          free(ptr);
+        }
+        break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->nanos[i] = nanos_between(&start, &end);
+    result->seconds += result->nanos[i] * 1e-9;
+
+    if(op->op == 'f'){
+      live -= sizes[op->id];
+      ptrs[op->id] = NULL;
+      sizes[op->id] = 0;
+    }
+    else if(newPtr == NULL){
+      result->failed++;
+    }
+    else{
+      // touch the memory like a real program would
+      memset(newPtr, op->id, op->nbytes < 64 ? op->nbytes : 64);
+      live += op->nbytes - sizes[op->id];
+      ptrs[op->id] = newPtr;
+      sizes[op->id] = op->nbytes;
+    }
+    // sample footprint and fragmentation outside of the timing
+    if(i % 256 == 0 || i == trace->len-1){
+      if(use_el){
+        if(live > result->peak_live){
+          result->fragmentation = el_fragmentation(NULL);
+        }
+        if(el_ctl.mmap_bytes > mapped){
+          mapped = el_ctl.mmap_bytes;
+        }
+      }
+      else{
+        size_t footprint = glibc_footprint() - baseline;
+        if(footprint > result->peak_footprint){
+          result->peak_footprint = footprint;
+        }
+        if(live > result->peak_live){
+          // glibc does not expose its largest free chunk so report
+          // the share of its arena that is free
+          struct mallinfo2 info = mallinfo2();
+          result->fragmentation = info.arena == 0 ? 0.0 : (double) info.fordblks / info.arena;
+        }
+      }
+    }
+    if(live > result->peak_live){
+      result->peak_live = live;
+    }
+  }
+  if(use_el){
+    // the heap above untouched has never been handed out; huge
+    // blocks mapped outside it are added at their sampled peak
+    result->peak_footprint = PTR_MINUS_PTR(el_ctl.untouched, el_ctl.heap_start) + mapped;
+  }
+  // anything the trace left live is freed outside the timing
+  for(int id=0; id<trace->ids; id++){
+    if(ptrs[id] != NULL){
+      if(use_el){
+        el_free(ptrs[id]);
+      }
+      else{
+        free(ptrs[id]);
+      }
+    }
+  }
+  free(ptrs);
+  free(sizes);
+}
+
+int cmp_long(const void *a, const void *b){
+  long x = *(const long *) a;
+  long y = *(const long *) b;
+  return (x > y) - (x < y);
+}
+
+void print_result(char *name, trace_t *trace, result_t *result){
+  qsort(result->nanos, trace->len, sizeof(long), cmp_long);
+  double pct[] = {0.50, 0.90, 0.99, 0.999};
+  printf("%-6s %10.0f ops/s", name, trace->len / result->seconds);
+  for(int i=0; i<4; i++){
+    size_t idx = (size_t) (pct[i] * (trace->len-1));
+    printf("  p%g %6ldns", pct[i]*100, result->nanos[idx]);
+  }
+  printf("  max %8ldns\n", result->nanos[trace->len-1]);
+  printf("%-6s peak footprint %10zu  peak live %10zu  overhead %5.1f%%  frag %.3f  failed %zu\n",
+         "", result->peak_footprint, result->peak_live,
+         result->peak_live == 0 ? 0.0 :
+         100.0 * ((double) result->peak_footprint - result->peak_live) / result->peak_live,
+         result->fragmentation, result->failed);
+  free(result->nanos);
+}
+
+// One side of the batch comparison: allocate nops objects count at a
+// time, freeing each group in a random order, with the batch
+// functions if use_batch is set. Prints per-object times and the
+// allocator counters.
+void batch_run(int use_batch, size_t count, size_t nops, int live,
+               size_t lo, size_t hi, int heap_mb, int seed,
+               size_t quick_max, size_t quick_count){
+  el_init(heap_mb << 20);
+  el_set_quick_limits(quick_max, quick_count);
+  srand(seed);
+  // fragment the heap the same way for both sides
+  void **held = calloc(live, sizeof(void *));
+  for(int i=0; i<live; i++){
+    held[i] = el_malloc(size_uniform(lo, hi));
+  }
+  for(int i=0; i<live; i+=2){
+    el_free(held[i]);
+  }
+  el_stats_t before;
+  el_get_stats(&before);
+
+  void **ptrs = malloc(count * sizeof(void *));
+  long alloc_nanos = 0, free_nanos = 0;
+  size_t failed = 0;
+  struct timespec start, end;
+  for(size_t done=0; done < nops; done += count){
+    size_t nbytes = size_uniform(lo, hi);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(use_batch){
+      el_malloc_batch(nbytes, count, ptrs);
+    }
+    else{
+      for(size_t i=0; i<count; i++){
+        ptrs[i] = el_malloc(nbytes);
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    alloc_nanos += nanos_between(&start, &end);
+    for(size_t i=0; i<count; i++){
+      if(ptrs[i] == NULL){
+        failed++;
+      }
+      else{
+        memset(ptrs[i], i, nbytes < 64 ? nbytes : 64);
+      }
+    }
+    for(size_t i=count-1; i>0; i--){
+      size_t j = rand() % (i+1);
+      void *tmp = ptrs[i];
+      ptrs[i] = ptrs[j];
+      ptrs[j] = tmp;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(use_batch){
+      el_free_batch(ptrs, count);
+    }
+    else{
+      for(size_t i=0; i<count; i++){
+        el_free(ptrs[i]);
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free_nanos += nanos_between(&start, &end);
+  }
+  el_stats_t stats;
+  el_get_stats(&stats);
+  el_cleanup();
+  free(ptrs);
+  free(held);
+
+  size_t objects = (nops + count - 1) / count * count;
+  printf("%-6s alloc %6.1fns/obj  free %6.1fns/obj  splits %zu  merges %zu  search steps %zu  failed %zu\n",
+         use_batch ? "batch" : "single",
+         (double) alloc_nanos / objects, (double) free_nanos / objects,
+         stats.splits - before.splits, stats.merges - before.merges,
+         stats.search_steps - before.search_steps, failed);
+}
+
+// One side of the alignment comparison: live buffers aligned to
+// alignment with el_aligned_alloc() if use_aligned is set, otherwise
+// by over-allocating with el_malloc(). Prints the waste per block,
+// the available blocks left over and the footprint.
+void align_run(int use_aligned, size_t alignment, int live,
+               size_t lo, size_t hi, int heap_mb, int seed){
+  el_init(heap_mb << 20);
+  srand(seed);
+  void **ptrs = calloc(live, sizeof(void *));
+  size_t *sizes = calloc(live, sizeof(size_t));
+  size_t failed = 0;
+  long nanos = 0;
+  struct timespec start, end;
+  // fill, then free every other buffer and refill so slack is reused
+  for(int pass=0; pass<2; pass++){
+    for(int i=0; i<live; i += pass+1){
+      if(pass == 1){
+        el_free(ptrs[i]);
+      }
+      sizes[i] = size_uniform(lo, hi);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      ptrs[i] = use_aligned ? el_aligned_alloc(alignment, sizes[i])
+                            : el_malloc(sizes[i] + alignment - 1);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      nanos += nanos_between(&start, &end);
+    }
+  }
+  size_t requested = 0;
+  for(int i=0; i<live; i++){
+    if(ptrs[i] == NULL){
+      failed++;
+    }
+    else{
+      requested += sizes[i];
+    }
+  }
+  size_t blocks = live - failed;
+  el_stats_t stats;
+  el_get_stats(&stats);
+  size_t footprint = PTR_MINUS_PTR(el_ctl.untouched, el_ctl.heap_start);
+  el_cleanup();
+  free(ptrs);
+  free(sizes);
+
+  printf("%-9s alloc %6.1fns/obj  wasted %7.1f bytes/block  available blocks %zu  footprint %zu  failed %zu\n",
+         use_aligned ? "aligned" : "overalloc",
+         (double) nanos / (live + (live+1)/2),
+         blocks == 0 ? 0.0 : (double) (stats.used_bytes - requested) / blocks - EL_BLOCK_OVERHEAD,
+         stats.avail_blocks, footprint, failed);
+}
+
+// One side of the append comparison: grow a buffer by count chunks
+// of chunk bytes with el_realloc() if use_realloc is set, otherwise
+// by allocating, copying and freeing. A mmap_threshold of -1 leaves
+// the adaptive default.
+void append_run(int use_realloc, size_t count, size_t chunk, int heap_mb,
+                long mmap_threshold){
+  el_init(heap_mb << 20);
+  if(mmap_threshold >= 0){
+    el_set_mmap_threshold(mmap_threshold);
+  }
+  size_t len = 0;
+  char *buf = el_malloc(chunk);
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(size_t i=0; i<count && buf != NULL; i++){
+    if(use_realloc){
+      buf = el_realloc(buf, len + chunk);
+    }
+    else{
+      char *grown = el_malloc(len + chunk);
+      if(grown != NULL){
+        memcpy(grown, buf, len);
+      }
+      el_free(buf);
+      buf = grown;
+    }
+    if(buf != NULL){
+      memset(buf + len, 'a', chunk);
+      len += chunk;
+    }
+    //a neighbor now and then, left for el_cleanup()
+    if(i % 1000 == 0){
+      el_malloc(32);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  el_cleanup();
+
+  printf("%-7s %8.1fns/append  final size %zu%s\n",
+         use_realloc ? "realloc" : "copy",
+         (double) nanos_between(&start, &end) / count, len,
+         buf == NULL ? "  FAILED" : "");
+}
+
+void usage(){
+  fprintf(stderr,
+          "usage: el_bench [-a el|glibc|both] [-n ops] [-l live] [-z min,max]\n"
+          "                [-s seed] [-H megabytes] [-w tracefile] [-q size,count] [-m bytes]\n"
+          "                {-t tracefile | -g uniform|powerlaw|prodcons | -b count | -A alignment |\n"
+          "                 -r count,bytes}\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[]){
+  char *allocs = "both";
+  char *tracefile = NULL;
+  char *generator = NULL;
+  char *outfile = NULL;
+  size_t nops = 1000000;
+  int live = 10000;
+  size_t lo = 16, hi = 512;
+  int seed = 1;
+  int heap_mb = 512;
+  size_t batch = 0;
+  size_t alignment = 0;
+  size_t appends = 0, append_bytes = 0;
+  size_t quick_max = 0, quick_count = 0;
+  long mmap_threshold = -1;
+
+  for(int i=1; i<argc; i++){
+    if(i+1 == argc || strlen(argv[i]) != 2 || argv[i][0] != '-'){
+      usage();
+    }
+    char *arg = argv[++i];
+    switch(argv[i-1][1]){
+      case 'a': allocs = arg;                         break;
+      case 't': tracefile = arg;                      break;
+      case 'g': generator = arg;                      break;
+      case 'w': outfile = arg;                        break;
+      case 'n': nops = strtoul(arg, NULL, 10);        break;
+      case 'l': live = atoi(arg);                     break;
+      case 's': seed = atoi(arg);                     break;
+      case 'H': heap_mb = atoi(arg);                  break;
+      case 'b': batch = strtoul(arg, NULL, 10);       break;
+      case 'A': alignment = strtoul(arg, NULL, 10);   break;
+      case 'm': mmap_threshold = atol(arg);           break;
+      case 'q':
+        if(sscanf(arg, "%zu,%zu", &quick_max, &quick_count) != 2){
+          usage();
+        }
+        break;
+      case 'r':
+        if(sscanf(arg, "%zu,%zu", &appends, &append_bytes) != 2 || appends == 0){
+          usage();
+        }
+        break;
+      case 'z':
+        if(sscanf(arg, "%zu,%zu", &lo, &hi) != 2 || lo > hi){
+          usage();
+        }
+        break;
+      default: usage();
+    }
+  }
+  if(live <= 0 || heap_mb <= 0 || heap_mb >= 2048 || (alignment & (alignment-1)) != 0){
+    usage();
+  }
+  if(batch > 0 && tracefile == NULL && generator == NULL){
+    printf("batch of %zu: %zu objects, sizes %zu-%zu, %d live\n", batch, nops, lo, hi, live);
+    batch_run(0, batch, nops, live, lo, hi, heap_mb, seed, quick_max, quick_count);
+    batch_run(1, batch, nops, live, lo, hi, heap_mb, seed, quick_max, quick_count);
+    return 0;
+  }
+  if(alignment > 0 && tracefile == NULL && generator == NULL){
+    printf("aligned to %zu: %d live, sizes %zu-%zu\n", alignment, live, lo, hi);
+    align_run(0, alignment, live, lo, hi, heap_mb, seed);
+    align_run(1, alignment, live, lo, hi, heap_mb, seed);
+    return 0;
+  }
+  if(appends > 0 && tracefile == NULL && generator == NULL){
+    printf("append: %zu appends of %zu bytes\n", appends, append_bytes);
+    append_run(1, appends, append_bytes, heap_mb, mmap_threshold);
+    append_run(0, appends, append_bytes, heap_mb, mmap_threshold);
+    return 0;
+  }
+  if((tracefile == NULL) == (generator == NULL) || batch > 0 || alignment > 0 || appends > 0){
+    usage();
+  }
+
+  trace_t trace = {};
+  srand(seed);
+  if(tracefile != NULL){
+    if(trace_read(&trace, tracefile) != 0){
+      return 1;
+    }
+  }
+  else if(strcmp(generator, "uniform") == 0){
+    gen_random(&trace, nops, live, lo, hi, size_uniform);
+  }
+  else if(strcmp(generator, "powerlaw") == 0){
+    gen_random(&trace, nops, live, lo, hi, size_powerlaw);
+  }
+  else if(strcmp(generator, "prodcons") == 0){
+    gen_prodcons(&trace, nops, live, lo, hi);
+  }
+  else{
+    usage();
+  }
+  if(outfile != NULL){
+    trace_write(&trace, outfile);
+  }
+  if(trace.len == 0){
+    fprintf(stderr,"el_bench: empty trace\n");
+    return 1;
+  }
+
+  printf("%s: %zu ops over %d ids\n",
+         tracefile != NULL ? tracefile : generator, trace.len, trace.ids);
+  result_t result;
+  if(strcmp(allocs, "el") == 0 || strcmp(allocs, "both") == 0){
+    el_init(heap_mb << 20);
+    el_set_quick_limits(quick_max, quick_count);
+    if(mmap_threshold >= 0){
+      el_set_mmap_threshold(mmap_threshold);
+    }
+    replay(&trace, 1, &result);
+    el_stats_t stats;
+    el_get_stats(&stats);
+    el_cleanup();
+    print_result("el", &trace, &result);
+    printf("%-6s splits %zu  merges %zu  avg search steps %.1f  max search steps %zu\n",
+           "", stats.splits, stats.merges,
+           stats.searches == 0 ? 0.0 : (double) stats.search_steps / stats.searches,
+           stats.max_search_steps);
+    if(quick_count > 0){
+      printf("%-6s quick hits %zu  quick flushes %zu\n", "", stats.quick_hits, stats.quick_flushes);
+    }
+    if(stats.mmaps > 0){
+      printf("%-6s mmaps %zu  final mmap threshold %zu\n", "", stats.mmaps, stats.mmap_threshold);
+    }
+  }
+  if(strcmp(allocs, "glibc") == 0 || strcmp(allocs, "both") == 0){
+    replay(&trace, 0, &result);
+    print_result("glibc", &trace, &result);
+  }
+  free(trace.ops);
+  return 0;
+}
@@ -1,72 +1,430 @@
 // el_malloc.c: implementation of explicit list malloc functions.
 //Madelyn Ogorek ogore014 5454524 CSCI 2021
 
+#define _GNU_SOURCE             // for mremap()
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "el_malloc.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Global control functions
 
 // Global control variable for the allocator. Must be initialized in
-// el_init().
-el_ctl_t el_ctl = {};
+// el_init(). It is the current arena of each thread until
+// el_arena_use() picks another; el_ctl refers to whichever is current.
+el_ctl_t el_default_ctl = {};
+__thread el_ctl_t *el_current = &el_default_ctl;
+
+// Whether in-use blocks are linked into el_ctl.used. The compact
+// layout has nowhere to put the links so never links them; building
+// with EL_UNLINKED_USED makes unlinked the default for the other
+// layout and el_set_used_links() switches at run time.
+#ifdef EL_COMPACT_HEADERS
+#define EL_LINK_USED 0
+#else
+#define EL_LINK_USED (el_ctl.link_used)
+#endif
+
+// quick list helpers, see the end of the file
+static el_blockhead_t *el_quick_pop(size_t size);
+static void el_quick_push(el_blockhead_t *block);
+static void el_flush_quick_list(int bin);
+static int el_quick_fits(size_t size);
+static int el_on_quick_list(el_blockhead_t *block);
+static void el_quick_save(int bin);
+static void el_quick_save_all();
+static void el_release_block(el_blockhead_t *head);
+
+// helpers for blocks in mappings of their own, see the end of the file
+static void *el_mmap_block(size_t nbytes, size_t alignment);
+static void *el_mremap_block(el_blockhead_t *head, size_t nbytes);
+static void el_free_mmapped(el_blockhead_t *head);
+static void el_munmap_all();
+
+static void el_setup_heap(void *heap, size_t max_bytes,
+                          el_blocklist_t *avail, el_blocklist_t *used);
+#ifdef EL_OFFSET_LINKS
+static void el_recover_heap(el_file_header_t *file);
+#endif
+
+// Block layout recorded in heap files so a file is only reopened by
+// a build that lays blocks out the same way.
+#ifdef EL_COMPACT_HEADERS
+#define EL_FILE_LAYOUT 1
+#else
+#define EL_FILE_LAYOUT 0
+#endif
 
 // Create an initial block of memory for the heap using
-// malloc(). Initialize the el_ctl data structure to point at this
+// calloc(). Initialize the el_ctl data structure to point at this
 // block. Initialize the lists in el_ctl to contain a single large
-// block of available memory and no used blocks of memory.
+// block of available memory and no used blocks of memory. The heap
+// starts zeroed which el_calloc() relies on; for large heaps calloc()
+// hands back fresh mmap()'d pages so this costs no more than malloc().
 int el_init(int max_bytes){
-  void *heap = malloc(max_bytes);
+  void *heap = calloc(1, max_bytes);
   if(heap == NULL){
-    fprintf(stderr,"el_init: malloc() failed in setup\n");
+    fprintf(stderr,"el_init: calloc() failed in setup\n");
     exit(1);
   }
+  return el_init_heap(heap, max_bytes);
+}
+
+// Initialize the allocator to manage the zeroed region of max_bytes
+// at heap, for callers such as el_preload.c that cannot get the heap
+// from calloc(). The region still belongs to the caller: el_cleanup()
+// must not be called on it. Returns 0 on success and 1 if the region
+// is too small to hold a block.
+int el_init_heap(void *heap, size_t max_bytes){
+  if(max_bytes < EL_HEAP_PAD + EL_BLOCK_OVERHEAD + EL_MIN_SIZE){
+    fprintf(stderr,"el_init: heap size %ld to small for a block overhead %ld\n",
+            max_bytes,EL_BLOCK_OVERHEAD);
+    return 1;
+  }
+  el_setup_heap(heap, max_bytes, &el_ctl.avail_actual, &el_ctl.used_actual);
+  return 0;
+}
 
+// Reset el_ctl for the heap of max_bytes at heap, which must be big
+// enough for one block, with the given lists, and make the whole heap
+// one available block.
+static void el_setup_heap(void *heap, size_t max_bytes,
+                          el_blocklist_t *avail, el_blocklist_t *used){
   el_ctl.heap_bytes = max_bytes; // make the heap as big as possible to begin with
   el_ctl.heap_start = heap;      // set addresses of start and end of heap
   el_ctl.heap_end   = PTR_PLUS_BYTES(heap,max_bytes);
+  el_ctl.untouched  = heap;      // nothing has been handed out yet
+  el_ctl.root       = NULL;
+  el_ctl.heap_file  = NULL;
+  el_ctl.bump       = 0;
+  el_ctl.mmapped    = NULL;
+  el_ctl.mmap_threshold = EL_MMAP_THRESHOLD;
+  el_ctl.mmap_dynamic = 1;
+  el_ctl.mmap_blocks = 0;
+  el_ctl.mmap_bytes = 0;
+  memset(&el_ctl.stats, 0, sizeof(el_ctl.stats));
+  el_trace_stop();
 
-  if(el_ctl.heap_bytes < EL_BLOCK_OVERHEAD){
-    fprintf(stderr,"el_init: heap size %ld to small for a block overhead %ld\n",
-            el_ctl.heap_bytes,EL_BLOCK_OVERHEAD);
-    return 1;
-  }
+  el_init_blocklist(avail);
+  el_init_blocklist(used);
+  el_ctl.avail = avail;
+  el_ctl.used  = used;
+#if defined(EL_COMPACT_HEADERS) || defined(EL_UNLINKED_USED)
+  el_ctl.link_used = 0;
+#else
+  el_ctl.link_used = 1;
+#endif
+  memset(el_ctl.quick, 0, sizeof(el_ctl.quick));
+  memset(el_ctl.quick_length, 0, sizeof(el_ctl.quick_length));
+  el_ctl.quick_max = 0;
+  el_ctl.quick_count = 0;
+  el_ctl.quick_blocks = 0;
+  el_ctl.quick_bytes = 0;
 
-  el_init_blocklist(&el_ctl.avail_actual);
-  el_init_blocklist(&el_ctl.used_actual);
-  el_ctl.avail = &el_ctl.avail_actual;
-  el_ctl.used  = &el_ctl.used_actual;
+  // the compact layout pads the start so payloads are aligned and
+  // trims the end to a whole number of aligned blocks
+  size_t span = (el_ctl.heap_bytes - EL_HEAP_PAD) / EL_ALIGN * EL_ALIGN;
 
   // establish the first available block by filling in size in
   // block/foot and null links in head
-  size_t size = el_ctl.heap_bytes - EL_BLOCK_OVERHEAD;
-  el_blockhead_t *ablock = el_ctl.heap_start;
-  ablock->size = size;
-  ablock->state = EL_AVAILABLE;
-  el_blockfoot_t *afoot = el_get_footer(ablock);
-  afoot->size = size;
+  size_t size = span - EL_BLOCK_OVERHEAD;
+  el_blockhead_t *ablock = PTR_PLUS_BYTES(el_ctl.heap_start, EL_HEAP_PAD);
+  el_ctl.heap_end = PTR_PLUS_BYTES(ablock, span);
+  ablock->size = 0;
+  el_set_size(ablock, size);
+  el_set_state(ablock, EL_AVAILABLE);
+  el_sync_footer(ablock);
   el_add_block_front(el_ctl.avail, ablock);
+}
+
+// Initialize the allocator with a heap kept in the file at path so it
+// survives the process. A missing or empty file is created with room
+// for a heap of max_bytes. An existing file is mapped back as it was
+// left by el_cleanup() and max_bytes is ignored; nothing is rebuilt,
+// the lists and counters are read from the file header. The file may
+// map at a different address each time so data structures in the heap
+// must link objects by offsets from el_ctl.heap_start, not pointers;
+// el_get_root() finds the top object again. A file that was not
+// closed by el_cleanup() has the blocks on its quick lists released
+// and is then checked with el_check_heap(); its counters start from
+// zero and el_calloc() zeroes every block. Needs
+// a build with EL_OFFSET_LINKS. Returns 0 on success and 1 on failure
+// with a message on stderr.
+int el_init_file(const char *path, size_t max_bytes){
+#ifndef EL_OFFSET_LINKS
+  fprintf(stderr,"el_init_file: %s: heap files need a build with EL_OFFSET_LINKS\n", path);
+  return 1;
+#else
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0){
+    fprintf(stderr,"el_init_file: cannot open %s\n", path);
+    if(fd >= 0){
+      close(fd);
+    }
+    return 1;
+  }
+  int create = st.st_size == 0;
+  size_t file_bytes = create ? EL_FILE_HEADER_BYTES + max_bytes : (size_t) st.st_size;
+  if(create && (max_bytes < EL_HEAP_PAD + EL_BLOCK_OVERHEAD + EL_MIN_SIZE ||
+                ftruncate(fd, file_bytes) != 0)){
+    fprintf(stderr,"el_init_file: cannot make a heap of %lu bytes in %s\n", max_bytes, path);
+    close(fd);
+    return 1;
+  }
+  if(file_bytes < EL_FILE_HEADER_BYTES){
+    fprintf(stderr,"el_init_file: %s is not a heap file\n", path);
+    close(fd);
+    return 1;
+  }
+  el_file_header_t *file = mmap(NULL, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(file == MAP_FAILED){
+    fprintf(stderr,"el_init_file: cannot map %s\n", path);
+    return 1;
+  }
+  void *heap = PTR_PLUS_BYTES(file, EL_FILE_HEADER_BYTES);
+
+  if(create){
+    // the file starts zeroed like the calloc()'d heap of el_init()
+    el_setup_heap(heap, max_bytes, &file->avail, &file->used);
+    file->magic = EL_FILE_MAGIC;
+    file->version = EL_FILE_VERSION;
+    file->layout = EL_FILE_LAYOUT;
+    file->header_bytes = EL_FILE_HEADER_BYTES;
+    file->heap_bytes = max_bytes;
+    file->heap_end = PTR_MINUS_PTR(el_ctl.heap_end, heap);
+    file->untouched = 0;
+    file->root = (size_t) -1;
+    file->link_used = el_ctl.link_used;
+    el_ctl.mmap_threshold = 0;
+  }
+  else{
+    if(file->magic != EL_FILE_MAGIC || file->version != EL_FILE_VERSION ||
+       file->layout != EL_FILE_LAYOUT || file->header_bytes != EL_FILE_HEADER_BYTES ||
+       file->header_bytes + file->heap_bytes != file_bytes ||
+       file->heap_end > file->heap_bytes){
+      fprintf(stderr,"el_init_file: %s is not a heap file for this build\n", path);
+      munmap(file, file_bytes);
+      return 1;
+    }
+    // offsets are relative to heap_start so only the list sentinels'
+    // own pointers need fixing for the new address
+    el_ctl.heap_bytes = file->heap_bytes;
+    el_ctl.heap_start = heap;
+    el_ctl.heap_end   = PTR_PLUS_BYTES(heap, file->heap_end);
+    el_ctl.untouched  = PTR_PLUS_BYTES(heap, file->untouched);
+    el_ctl.root       = file->root == (size_t) -1 ? NULL : PTR_PLUS_BYTES(heap, file->root);
+    el_ctl.link_used  = file->link_used;
+    el_ctl.stats      = file->stats;
+    file->avail.beg = &file->avail.beg_actual;
+    file->avail.end = &file->avail.end_actual;
+    file->used.beg  = &file->used.beg_actual;
+    file->used.end  = &file->used.end_actual;
+    el_ctl.avail = &file->avail;
+    el_ctl.used  = &file->used;
+    memset(el_ctl.quick, 0, sizeof(el_ctl.quick));
+    memset(el_ctl.quick_length, 0, sizeof(el_ctl.quick_length));
+    el_ctl.quick_max = 0;
+    el_ctl.quick_count = 0;
+    el_ctl.quick_blocks = 0;
+    el_ctl.quick_bytes = 0;
+    el_ctl.bump = 0;
+    el_ctl.mmapped = NULL;
+    el_ctl.mmap_threshold = 0;
+    el_ctl.mmap_blocks = 0;
+    el_ctl.mmap_bytes = 0;
+    el_trace_stop();
+    if(!file->clean){
+      // untouched and stats are only saved by el_cleanup() so cannot
+      // be trusted; root, link_used and the quick lists are written
+      // as they change
+      fprintf(stderr,"el_init_file: %s was not closed cleanly, checking it\n", path);
+      el_ctl.untouched = el_ctl.heap_end;
+      memset(&el_ctl.stats, 0, sizeof(el_ctl.stats));
+      el_recover_heap(file);
+      if(el_check_heap() != 0){
+        fprintf(stderr,"el_init_file: %s is corrupt\n", path);
+        munmap(file, file_bytes);
+        el_ctl.heap_start = NULL;
+        return 1;
+      }
+    }
+  }
+  // mark the file in use before anything changes so a crash is noticed
+  el_ctl.heap_file = file;
+  el_quick_save_all();
+  file->clean = 0;
+  msync(file, EL_FILE_HEADER_BYTES, MS_SYNC);
   return 0;
+#endif
 }
 
 // Clean up the heap area associated with the system which simply
-// calls free() on the malloc'd block used as the heap.
+// calls free() on the malloc'd block used as the heap. A heap from
+// el_init_file() instead has its quick lists flushed and its state
+// saved to the file header before being written back and unmapped.
+// Blocks in mappings of their own are unmapped.
 void el_cleanup(){
-  free(el_ctl.heap_start);
+  el_munmap_all();
+  el_file_header_t *file = el_ctl.heap_file;
+  if(file != NULL){
+    el_flush_quick_lists();
+    file->untouched = PTR_MINUS_PTR(el_ctl.untouched, el_ctl.heap_start);
+    file->root = el_ctl.root == NULL ? (size_t) -1 : PTR_MINUS_PTR(el_ctl.root, el_ctl.heap_start);
+    file->link_used = el_ctl.link_used;
+    file->stats = el_ctl.stats;
+    // the heap must be on disk before the header says it is clean
+    msync(file, file->header_bytes + file->heap_bytes, MS_SYNC);
+    file->clean = 1;
+    msync(file, EL_FILE_HEADER_BYTES, MS_SYNC);
+    munmap(file, file->header_bytes + file->heap_bytes);
+    el_ctl.heap_file = NULL;
+  }
+  else{
+    free(el_ctl.heap_start);
+  }
   el_ctl.heap_start = NULL;
   el_ctl.heap_end   = NULL;
+  el_ctl.untouched  = NULL;
+  el_ctl.root       = NULL;
+}
+
+// Remember ptr, normally the top of the data structures kept in a
+// heap file, so el_get_root() can find it after the file is reopened.
+// It goes straight to the file header so survives a crash too.
+void el_set_root(void *ptr){
+  el_ctl.root = ptr;
+  if(el_ctl.heap_file != NULL){
+    el_ctl.heap_file->root = ptr == NULL ? (size_t) -1 : PTR_MINUS_PTR(ptr, el_ctl.heap_start);
+  }
+}
+
+// Return the pointer last given to el_set_root() or NULL.
+void *el_get_root(){
+  return el_ctl.root;
+}
+
+// Drop every allocation at once, leaving the heap a single available
+// block as el_init() does. Settings, counters and any trace carry on
+// but the root is cleared, in a heap file too. Memory handed out
+// before stays dirty so el_calloc() still zeroes it. Takes constant
+// time however much was allocated in the heap; blocks in mappings of
+// their own are unmapped one by one.
+void el_reset(){
+  el_munmap_all();
+  el_ctl_t saved = el_ctl;
+  el_setup_heap(el_ctl.heap_start, el_ctl.heap_bytes, el_ctl.avail, el_ctl.used);
+  el_ctl.untouched      = saved.untouched;
+  el_ctl.stats          = saved.stats;
+  el_ctl.link_used      = saved.link_used;
+  el_ctl.quick_max      = saved.quick_max;
+  el_ctl.quick_count    = saved.quick_count;
+  el_ctl.heap_file      = saved.heap_file;
+  el_ctl.bump           = saved.bump;
+  el_ctl.mmap_threshold = saved.mmap_threshold;
+  el_ctl.mmap_dynamic   = saved.mmap_dynamic;
+  el_ctl.trace          = saved.trace;
+  el_ctl.trace_capacity = saved.trace_capacity;
+  el_ctl.trace_every    = saved.trace_every;
+  el_ctl.trace_calls    = saved.trace_calls;
+  el_ctl.trace_count    = saved.trace_count;
+  el_set_root(NULL);
+  el_quick_save_all();
+}
+
+// Turn bump (monotonic) mode on or off. While on, el_free() and
+// el_free_batch() do nothing, so allocation never merges or revisits
+// freed blocks and carves straight from the remaining free space;
+// everything is given back together by el_reset(). Blocks freed while
+// bump mode is on stay allocated until then even if it is turned off.
+void el_set_bump(int on){
+  el_ctl.bump = on;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Arenas
+
+// Make a new arena with its own heap of max_bytes, separate from the
+// current one. Returns NULL if memory for it cannot be had.
+el_ctl_t *el_arena_create(size_t max_bytes){
+  el_ctl_t *arena = calloc(1, sizeof(el_ctl_t));
+  void *heap = calloc(1, max_bytes);
+  if(arena == NULL || heap == NULL){
+    free(arena);
+    free(heap);
+    return NULL;
+  }
+  el_ctl_t *prev = el_arena_use(arena);
+  int fail = el_init_heap(heap, max_bytes);
+  el_arena_use(prev);
+  if(fail){
+    free(heap);
+    free(arena);
+    return NULL;
+  }
+  return arena;
+}
+
+// Release an arena from el_arena_create() along with its heap. If it
+// was current, el_default_ctl becomes current again.
+void el_arena_destroy(el_ctl_t *arena){
+  el_ctl_t *prev = el_arena_use(arena);
+  el_cleanup();
+  el_arena_use(prev == arena ? &el_default_ctl : prev);
+  free(arena);
+}
+
+// Make arena the one the el_* functions act on in the calling thread
+// and return the arena that was current.
+el_ctl_t *el_arena_use(el_ctl_t *arena){
+  el_ctl_t *prev = el_current;
+  el_current = arena;
+  return prev;
+}
+
+// el_malloc() from the given arena, leaving the current one as is.
+void *el_arena_malloc(el_ctl_t *arena, size_t nbytes){
+  el_ctl_t *prev = el_arena_use(arena);
+  void *ptr = el_malloc(nbytes);
+  el_arena_use(prev);
+  return ptr;
+}
+
+// el_free() a block that came from the given arena.
+void el_arena_free(el_ctl_t *arena, void *ptr){
+  el_ctl_t *prev = el_arena_use(arena);
+  el_free(ptr);
+  el_arena_use(prev);
+}
+
+// Record that the given block has been handed out to a user so that
+// el_calloc() no longer treats memory up to its footer as zeroed.
+void el_mark_touched(el_blockhead_t *block){
+  void *end = PTR_PLUS_BYTES(block, EL_SIZE(block) + EL_BLOCK_OVERHEAD);
+  if(end > el_ctl.untouched){
+    el_ctl.untouched = end;
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Pointer arithmetic functions to access adjacent headers/footers
 
 // Compute the address of the foot for the given head which is at a
-// higher address than the head.
+// higher address than the head. The foot is the last thing in the
+// block so this works for both layouts; in the compact layout only
+// available blocks have a foot at this address.
 el_blockfoot_t *el_get_footer(el_blockhead_t *head){
-  size_t size = head->size;
-  el_blockfoot_t *foot = PTR_PLUS_BYTES(head, sizeof(el_blockhead_t) + size);
+  size_t size = EL_SIZE(head);
+  el_blockfoot_t *foot =
+    PTR_PLUS_BYTES(head, size + EL_BLOCK_OVERHEAD - sizeof(el_blockfoot_t));
   return foot;
 }
 
@@ -76,7 +434,7 @@ el_blockfoot_t *el_get_footer(el_blockhead_t *head){
 el_blockhead_t *el_get_header(el_blockfoot_t *foot){
   size_t size = foot->size;
   //literally doing the reverse arithmetic that get_footer did to get back to the header
-  void *head = PTR_MINUS_BYTES(foot, sizeof(el_blockhead_t) + size);
+  void *head = PTR_MINUS_BYTES(foot, size + EL_BLOCK_OVERHEAD - sizeof(el_blockfoot_t));
   //gets us back up to the head
   return head;
 }
@@ -89,7 +447,7 @@ el_blockhead_t *el_get_header(el_blockfoot_t *foot){
 el_blockhead_t *el_block_above(el_blockhead_t *block){
   //getting to the header of the block above
   el_blockhead_t *higher =
-    PTR_PLUS_BYTES(block, block->size + EL_BLOCK_OVERHEAD);
+    PTR_PLUS_BYTES(block, EL_SIZE(block) + EL_BLOCK_OVERHEAD);
     //preventing a segfault by making sure we don't go off the heap
   if((void *) higher >= (void*) el_ctl.heap_end){
     //we know we can't go any further in memory
@@ -109,7 +467,15 @@ el_blockhead_t *el_block_above(el_blockhead_t *block){
 //
 // WARNING: This function must perform slightly different arithmetic
 // than el_block_above(). Take care when implementing it.
+//
+// In the compact layout only an available block below has a foot so
+// this returns NULL unless the block's EL_PREV_FREE_BIT is set.
 el_blockhead_t *el_block_below(el_blockhead_t *block){
+#ifdef EL_COMPACT_HEADERS
+  if(!(block->size & EL_PREV_FREE_BIT)){
+    return NULL;
+  }
+#endif
   //moving over a little bit to get the footer of the adjacent
   el_blockfoot_t *footy = PTR_MINUS_BYTES(block, sizeof(el_blockfoot_t));
   //preventing us from calling get_header with an invalid address
@@ -125,6 +491,53 @@ el_blockhead_t *el_block_below(el_blockhead_t *block){
   }
 }
 
+// Set the size of the block in its header, leaving its state alone.
+// Does not touch the footer; see el_sync_footer().
+void el_set_size(el_blockhead_t *block, size_t size){
+#ifdef EL_COMPACT_HEADERS
+  block->size = size | (block->size & EL_FLAG_BITS);
+#else
+  block->size = size;
+#endif
+}
+
+// Set the state of the block to EL_AVAILABLE or EL_USED. In the
+// compact layout this also maintains the EL_PREV_FREE_BIT of the
+// block above and writes the footer which only available blocks
+// carry, so the size must be set before calling this.
+void el_set_state(el_blockhead_t *block, char state){
+#ifdef EL_COMPACT_HEADERS
+  el_blockhead_t *above = el_block_above(block);
+  if(state == EL_USED){
+    block->size |= EL_USED_BIT;
+    if(above != NULL){
+      above->size &= ~((size_t) EL_PREV_FREE_BIT);
+    }
+  }
+  else{
+    block->size &= ~((size_t) EL_USED_BIT);
+    if(above != NULL){
+      above->size |= EL_PREV_FREE_BIT;
+    }
+    el_get_footer(block)->size = EL_SIZE(block);
+  }
+#else
+  block->state = state;
+#endif
+}
+
+// Copy the size of the block from its header into its footer. In the
+// compact layout in-use blocks have no footer, the bytes belong to the
+// user, so nothing is written for them.
+void el_sync_footer(el_blockhead_t *block){
+#ifdef EL_COMPACT_HEADERS
+  if(EL_STATE(block) == EL_USED){
+    return;
+  }
+#endif
+  el_get_footer(block)->size = EL_SIZE(block);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Block list operations
 
@@ -144,21 +557,32 @@ void el_print_blocklist(el_blocklist_t *list){
   printf("blocklist{length: %6lu  bytes: %6lu}\n", list->length,list->bytes);
   el_blockhead_t *block = list->beg;
   for(int i=0; i<list->length; i++){
-    printf("  ");
+    block = EL_NEXT(block);
+    el_print_block(i, block);
+  }
 
-    block = block->next;
+}
 
-    printf("[%3d] head @ %6lu ", i,PTR_MINUS_PTR(block,el_ctl.heap_start));
+// Print a single block in the format used by el_print_blocklist(). In
+// the compact layout in-use blocks have no footer so none is shown.
+void el_print_block(int i, el_blockhead_t *block){
+  printf("  ");
 
-    printf("{state: %c  size: %6lu}", block->state,block->size);
+  printf("[%3d] head @ %6lu ", i,PTR_MINUS_PTR(block,el_ctl.heap_start));
 
-    el_blockfoot_t *foot = el_get_footer(block);
+  printf("{state: %c  size: %6lu}", EL_STATE(block),EL_SIZE(block));
 
-    printf("  foot @ %6lu ", PTR_MINUS_PTR(foot,el_ctl.heap_start));
-    printf("{size: %6lu}", foot->size);
+#ifdef EL_COMPACT_HEADERS
+  if(EL_STATE(block) == EL_USED){
     printf("\n");
+    return;
   }
+#endif
+  el_blockfoot_t *foot = el_get_footer(block);
 
+  printf("  foot @ %6lu ", PTR_MINUS_PTR(foot,el_ctl.heap_start));
+  printf("{size: %6lu}", foot->size);
+  printf("\n");
 }
 
 // Print out basic heap statistics. This shows total heap info along
@@ -176,13 +600,37 @@ void el_print_blocklist(el_blocklist_t *list){
 //   [  2] head @    514 {state: u  size:     64}  foot @    610 {size:     64}
 //   [  3] head @    452 {state: u  size:     22}  foot @    506 {size:     22}
 //   [  4] head @    168 {state: u  size:     48}  foot @    248 {size:     48}
+//
+// When used blocks are not linked (see el_set_used_links()) the used
+// list is reconstructed by walking the heap and appears in address
+// order. When quick lists are on (see el_set_quick_limits()) their
+// totals follow on a QUICK LISTS line, and those of blocks in
+// mappings of their own on a MMAPPED line when there are any.
 void el_print_stats(){
   printf("HEAP STATS\n");
   printf("Heap bytes: %lu\n",el_ctl.heap_bytes);
   printf("AVAILABLE LIST: ");
   el_print_blocklist(el_ctl.avail);
   printf("USED LIST: ");
-  el_print_blocklist(el_ctl.used);
+  if(EL_LINK_USED){
+    el_print_blocklist(el_ctl.used);
+  }
+  else{
+    printf("blocklist{length: %6lu  bytes: %6lu}\n", el_ctl.used->length,el_ctl.used->bytes);
+    int i = 0;
+    el_blockhead_t *block = PTR_PLUS_BYTES(el_ctl.heap_start, EL_HEAP_PAD);
+    for(; block != NULL; block = el_block_above(block)){
+      if(EL_STATE(block) == EL_USED && !el_on_quick_list(block)){
+        el_print_block(i++, block);
+      }
+    }
+  }
+  if(el_ctl.quick_count > 0){
+    printf("QUICK LISTS: length: %6lu  bytes: %6lu\n", el_ctl.quick_blocks,el_ctl.quick_bytes);
+  }
+  if(el_ctl.mmap_blocks > 0){
+    printf("MMAPPED: length: %6lu  bytes: %6lu\n", el_ctl.mmap_blocks,el_ctl.mmap_bytes);
+  }
 }
 
 // Initialize the specified list to be empty. Sets the beg/end
@@ -190,15 +638,17 @@ void el_print_stats(){
 // ends of the list.  Initializes length and size to 0.
 void el_init_blocklist(el_blocklist_t *list){
   list->beg        = &(list->beg_actual);
-  list->beg->state = EL_BEGIN_BLOCK;
   list->beg->size  = EL_UNINITIALIZED;
   list->end        = &(list->end_actual);
-  list->end->state = EL_END_BLOCK;
   list->end->size  = EL_UNINITIALIZED;
-  list->beg->next  = list->end;
-  list->beg->prev  = NULL;
-  list->end->next  = NULL;
-  list->end->prev  = list->beg;
+#ifndef EL_COMPACT_HEADERS
+  list->beg->state = EL_BEGIN_BLOCK;
+  list->end->state = EL_END_BLOCK;
+#endif
+  EL_SET_NEXT(list->beg, list->end);
+  EL_SET_PREV(list->beg, NULL);
+  EL_SET_NEXT(list->end, NULL);
+  EL_SET_PREV(list->end, list->beg);
   list->length     = 0;
   list->bytes      = 0;
 }
@@ -211,15 +661,15 @@ void el_add_block_front(el_blocklist_t *list, el_blockhead_t *block){
   //incrementing list's length
   list->length++;
   //adding the new bytes
-  list->bytes += block->size + EL_BLOCK_OVERHEAD;
+  list->bytes += EL_SIZE(block) + EL_BLOCK_OVERHEAD;
   //linking the node's previous field
-  block->prev = list->beg;
+  EL_SET_PREV(block, list->beg);
   //linking the node's next field
   block->next = list->beg->next;
   //linking the beginning dummy node's next pointer
-  block->prev->next = block;
+  EL_SET_NEXT(list->beg, block);
   //linking the original first node's previous field to the new node
-  block->next->prev = block;
+  EL_SET_PREV(EL_NEXT(block), block);
 }
 
 // REQUIRED
@@ -230,16 +680,341 @@ void el_remove_block(el_blocklist_t *list, el_blockhead_t *block){
   //decrementing length
   list->length--;
   //deleting bytes
-  list->bytes -= block->size + EL_BLOCK_OVERHEAD;
+  list->bytes -= EL_SIZE(block) + EL_BLOCK_OVERHEAD;
   //mending the gap
-  block->prev->next = block->next;
+  EL_PREV(block)->next = block->next;
   //mending the gap
-  block->next->prev = block->prev;
+  EL_NEXT(block)->prev = block->prev;
+}
+
+// Add an in-use block to the used list. When used blocks are not
+// linked the block is only counted, which avoids touching the
+// neighboring list nodes on every allocation.
+void el_add_used(el_blockhead_t *block){
+  if(EL_LINK_USED){
+    el_add_block_front(el_ctl.used, block);
+    return;
+  }
+  el_ctl.used->length++;
+  el_ctl.used->bytes += EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+}
+
+// Remove an in-use block from the used list; counterpart to
+// el_add_used().
+void el_remove_used(el_blockhead_t *block){
+  if(EL_LINK_USED){
+    el_remove_block(el_ctl.used, block);
+    return;
+  }
+  el_ctl.used->length--;
+  el_ctl.used->bytes -= EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+}
+
+// Turn linking of in-use blocks into el_ctl.used on or off; call
+// after el_init(). Turning it off keeps only the length/bytes
+// counters. Turning it on relinks every in-use block by walking the
+// heap, so first empties the quick lists whose blocks look in use.
+// Returns 0 on success and 1 if links were requested in the compact
+// layout which has no room for them.
+int el_set_used_links(int on){
+#ifdef EL_COMPACT_HEADERS
+  return on ? 1 : 0;
+#else
+  if(on){
+    el_flush_quick_lists();
+  }
+  size_t length = el_ctl.used->length;
+  size_t bytes = el_ctl.used->bytes;
+  el_init_blocklist(el_ctl.used);
+  el_ctl.link_used = on;
+  if(el_ctl.heap_file != NULL){
+    el_ctl.heap_file->link_used = on;
+  }
+  if(!on){
+    el_ctl.used->length = length;
+    el_ctl.used->bytes = bytes;
+    return 0;
+  }
+  el_blockhead_t *block = PTR_PLUS_BYTES(el_ctl.heap_start, EL_HEAP_PAD);
+  for(; block != NULL; block = el_block_above(block)){
+    if(EL_STATE(block) == EL_USED){
+      el_add_block_front(el_ctl.used, block);
+    }
+  }
+  return 0;
+#endif
+}
+
+// Check that a block list is well formed: the links run from beg to
+// end and back through length blocks inside the heap, each in the
+// given state, adding up to bytes. Returns 0 if so.
+static int el_check_list(el_blocklist_t *list, char state){
+  size_t bytes = 0;
+  el_blockhead_t *prev = list->beg;
+  el_blockhead_t *block = EL_NEXT(list->beg);
+  for(size_t i=0; i<list->length; i++){
+    if((void *) block < el_ctl.heap_start || (void *) block >= el_ctl.heap_end ||
+       EL_PREV(block) != prev || EL_STATE(block) != state){
+      return 1;
+    }
+    bytes += EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+    prev = block;
+    block = EL_NEXT(block);
+  }
+  return block != list->end || EL_PREV(block) != prev || bytes != list->bytes;
+}
+
+// Walk the whole heap and the lists checking that they agree: blocks
+// tile the heap exactly, available blocks have matching footers and
+// are never adjacent, and the lists hold exactly the available and
+// in-use blocks. Takes time proportional to the heap so is meant for
+// debugging and for heap files that were not closed cleanly. Returns
+// 0 if the heap is consistent, otherwise prints the first problem to
+// stderr and returns 1.
+int el_check_heap(){
+  size_t avail = 0, avail_bytes = 0;
+  size_t used = 0, used_bytes = 0;
+  int below_free = 0;
+  el_blockhead_t *block = PTR_PLUS_BYTES(el_ctl.heap_start, EL_HEAP_PAD);
+  while((void *) block < el_ctl.heap_end){
+    size_t size = EL_SIZE(block);
+    void *end = PTR_PLUS_BYTES(block, size + EL_BLOCK_OVERHEAD);
+    if(size > el_ctl.heap_bytes || end > el_ctl.heap_end){
+      fprintf(stderr,"el_check_heap: block @ %lu has bad size %lu\n",
+              PTR_MINUS_PTR(block, el_ctl.heap_start), size);
+      return 1;
+    }
+#ifdef EL_COMPACT_HEADERS
+    if(((block->size & EL_PREV_FREE_BIT) != 0) != below_free){
+      fprintf(stderr,"el_check_heap: block @ %lu has a wrong EL_PREV_FREE_BIT\n",
+              PTR_MINUS_PTR(block, el_ctl.heap_start));
+      return 1;
+    }
+#else
+    if(EL_STATE(block) != EL_AVAILABLE && EL_STATE(block) != EL_USED){
+      fprintf(stderr,"el_check_heap: block @ %lu has bad state %d\n",
+              PTR_MINUS_PTR(block, el_ctl.heap_start), EL_STATE(block));
+      return 1;
+    }
+#endif
+    if(EL_STATE(block) == EL_AVAILABLE){
+      if(below_free || el_get_footer(block)->size != size){
+        fprintf(stderr,"el_check_heap: available block @ %lu is unmerged or has a bad footer\n",
+                PTR_MINUS_PTR(block, el_ctl.heap_start));
+        return 1;
+      }
+      avail++;
+      avail_bytes += size + EL_BLOCK_OVERHEAD;
+    }
+    else{
+      used++;
+      used_bytes += size + EL_BLOCK_OVERHEAD;
+    }
+    below_free = EL_STATE(block) == EL_AVAILABLE;
+    block = end;
+  }
+  //blocks on quick lists look in use but are not on the used list
+  if(avail != el_ctl.avail->length || avail_bytes != el_ctl.avail->bytes ||
+     used != el_ctl.used->length + el_ctl.quick_blocks ||
+     used_bytes != el_ctl.used->bytes + el_ctl.quick_bytes){
+    fprintf(stderr,"el_check_heap: list totals do not match the heap\n");
+    return 1;
+  }
+  if(el_check_list(el_ctl.avail, EL_AVAILABLE) != 0 ||
+     (EL_LINK_USED && el_check_list(el_ctl.used, EL_USED) != 0)){
+    fprintf(stderr,"el_check_heap: broken list links\n");
+    return 1;
+  }
+  return 0;
+}
+
+#ifdef EL_OFFSET_LINKS
+// Release the blocks a crash left on quick lists, which look in use
+// but are on no list. They are found from the tops and lengths of the
+// lists that are kept in the file header. A block that is not in use
+// or does not fit in the heap ends its list; anything left over is for
+// el_check_heap() to report.
+static void el_recover_heap(el_file_header_t *file){
+  for(int bin=0; bin<EL_QUICK_BINS; bin++){
+    el_blockhead_t *block = EL_LINKED(file->quick[bin]);
+    for(size_t i=0; i<file->quick_length[bin] && block != NULL; i++){
+      if((void *) block < el_ctl.heap_start || (void *) block >= el_ctl.heap_end ||
+         EL_STATE(block) != EL_USED || EL_SIZE(block) > el_ctl.heap_bytes ||
+         PTR_PLUS_BYTES(block, EL_SIZE(block) + EL_BLOCK_OVERHEAD) > el_ctl.heap_end){
+        break;
+      }
+      el_blockhead_t *next = EL_NEXT(block);
+      el_release_block(block);
+      block = next;
+    }
+  }
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Statistics and tracing
+
+// Pending sample for the event trace, filled in by el_trace_begin()
+// and completed by el_trace_end().
+typedef struct {
+  int on;                       // 1 if this call is being recorded
+  size_t steps;                 // search_steps when the call started
+  struct timespec start;        // time when the call started
+} el_trace_mark_t;
+
+// Count an allocation request of nbytes in the size histogram.
+// Bucket i holds requests in [2^i, 2^(i+1)) with the last bucket
+// also holding everything larger.
+void el_count_request(size_t nbytes){
+  int bucket = 0;
+  if(nbytes > 1){
+    bucket = (int) (8*sizeof(unsigned long)) - 1 - __builtin_clzl(nbytes);
+  }
+  if(bucket >= EL_HIST_BUCKETS){
+    bucket = EL_HIST_BUCKETS - 1;
+  }
+  el_ctl.stats.hist[bucket]++;
+}
+
+// Track the peak bytes in use after a block is handed out or grown.
+void el_count_used(){
+  if(el_ctl.used->bytes > el_ctl.stats.peak_bytes){
+    el_ctl.stats.peak_bytes = el_ctl.used->bytes;
+  }
+}
+
+// Count one call to el_find_first_avail() that examined the given
+// number of blocks.
+void el_count_search(size_t steps){
+  el_ctl.stats.searches++;
+  el_ctl.stats.search_steps += steps;
+  if(steps > el_ctl.stats.max_search_steps){
+    el_ctl.stats.max_search_steps = steps;
+  }
+}
+
+// Copy the allocator counters into stats along with the current
+// list lengths and byte totals. Runs in constant time.
+void el_get_stats(el_stats_t *stats){
+  *stats = el_ctl.stats;
+  stats->used_blocks  = el_ctl.used->length;
+  stats->used_bytes   = el_ctl.used->bytes;
+  stats->avail_blocks = el_ctl.avail->length;
+  stats->avail_bytes  = el_ctl.avail->bytes;
+  stats->quick_blocks = el_ctl.quick_blocks;
+  stats->quick_bytes  = el_ctl.quick_bytes;
+  stats->mmap_blocks  = el_ctl.mmap_blocks;
+  stats->mmap_bytes   = el_ctl.mmap_bytes;
+  stats->mmap_threshold = el_ctl.mmap_threshold;
+}
+
+// Walk the available list and return the fragmentation of free
+// space: 0 when all free bytes are in one block, approaching 1 as
+// they are scattered over many small blocks. Also reports the
+// largest available block size in largest if it is not NULL. Takes
+// time proportional to the available list length so is only meant
+// to be called on demand.
+double el_fragmentation(size_t *largest){
+  size_t big = 0;
+  size_t total = 0;
+  el_blockhead_t *block = EL_NEXT(el_ctl.avail->beg);
+  for(size_t i=0; i<el_ctl.avail->length; i++){
+    if(EL_SIZE(block) > big){
+      big = EL_SIZE(block);
+    }
+    total += EL_SIZE(block);
+    block = EL_NEXT(block);
+  }
+  if(largest != NULL){
+    *largest = big;
+  }
+  if(total == 0){
+    return 0.0;
+  }
+  return 1.0 - (double) big / (double) total;
+}
+
+// Start recording every sample_every'th call to el_malloc(),
+// el_calloc(), el_aligned_alloc(), el_realloc(), el_free() and the
+// batch functions into the ring buffer of capacity events. The newest
+// event is at index (el_trace_count()-1) % capacity. Calls the
+// allocator makes internally are never recorded separately.
+void el_trace_start(el_trace_event_t *ring, size_t capacity, size_t sample_every){
+  el_ctl.trace = ring;
+  el_ctl.trace_capacity = capacity;
+  el_ctl.trace_every = sample_every == 0 ? 1 : sample_every;
+  el_ctl.trace_calls = 0;
+  el_ctl.trace_count = 0;
+  if(capacity == 0){
+    el_ctl.trace = NULL;
+  }
+}
+
+// Stop recording events. The ring buffer is left as is.
+void el_trace_stop(){
+  el_ctl.trace = NULL;
+}
+
+// Return the total number of events recorded since el_trace_start();
+// once this exceeds the capacity the oldest events are overwritten.
+size_t el_trace_count(){
+  return el_ctl.trace_count;
+}
+
+// Decide whether the call about to run is sampled and if so note
+// when it started.
+static void el_trace_begin(el_trace_mark_t *mark){
+  mark->on = 0;
+  if(el_ctl.trace == NULL || el_ctl.trace_calls++ % el_ctl.trace_every != 0){
+    return;
+  }
+  mark->on = 1;
+  mark->steps = el_ctl.stats.search_steps;
+  clock_gettime(CLOCK_MONOTONIC, &mark->start);
+}
+
+// Finish a sampled call by writing its event into the ring buffer.
+static void el_trace_end(el_trace_mark_t *mark, char op, size_t nbytes, void *ptr){
+  if(!mark->on){
+    return;
+  }
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  el_trace_event_t *event = &el_ctl.trace[el_ctl.trace_count % el_ctl.trace_capacity];
+  event->op = op;
+  event->nbytes = nbytes;
+  event->offset = ptr < el_ctl.heap_start || ptr >= el_ctl.heap_end
+    ? EL_TRACE_NO_OFFSET : PTR_MINUS_PTR(ptr, el_ctl.heap_start);
+  event->steps = el_ctl.stats.search_steps - mark->steps;
+  event->nanos = (end.tv_sec - mark->start.tv_sec) * 1000000000L
+    + (end.tv_nsec - mark->start.tv_nsec);
+  el_ctl.trace_count++;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Allocation-related functions
 
+static void *el_do_malloc(size_t nbytes);
+static void *el_do_aligned_alloc(size_t alignment, size_t nbytes);
+static void *el_do_realloc(void *ptr, size_t nbytes);
+static void el_do_free(void *ptr);
+static size_t el_do_malloc_batch(size_t nbytes, size_t count, void **ptrs);
+static void el_do_free_batch(void **ptrs, size_t count);
+
+// Convert a request for nbytes into the block size used to serve
+// it. Sizes are rounded so blocks stay EL_ALIGN aligned and are large
+// enough to hold links and a footer once freed; the default layout
+// uses the request as is. Callers must reject requests larger than
+// the heap first so this cannot overflow.
+size_t el_request_size(size_t nbytes){
+  size_t size = (nbytes + EL_BLOCK_OVERHEAD + EL_ALIGN - 1) / EL_ALIGN * EL_ALIGN
+    - EL_BLOCK_OVERHEAD;
+  if(size < EL_MIN_SIZE){
+    size = EL_MIN_SIZE;
+  }
+  return size;
+}
+
 // REQUIRED
 // Find the first block in the available list with block size of at
 // least (size+EL_BLOCK_OVERHEAD). Overhead is accounted so this
@@ -249,24 +1024,26 @@ void el_remove_block(el_blocklist_t *list, el_blockhead_t *block){
 el_blockhead_t *el_find_first_avail(size_t size){
   //keeping track of how many times I step through the list
   int count = 0;
-  el_blockhead_t *temp = el_ctl.avail->beg->next;
+  el_blockhead_t *temp = EL_NEXT(el_ctl.avail->beg);
   //geting the first actual node
   while(count <= el_ctl.avail->length)
   {
     //seeing if the current node has enough space for my malloc
-    if(temp->size >= (size + EL_BLOCK_OVERHEAD))
+    if(EL_SIZE(temp) >= (size + EL_BLOCK_OVERHEAD))
     {
       //returnin pointer to that head
+      el_count_search(count+1);
       return temp;
     }
     else
     {
       //progressing through the list
-      temp = temp->next;
+      temp = EL_NEXT(temp);
       count++;
     }
   }
   //no space was found
+  el_count_search(count);
   return NULL;
 }
 
@@ -279,29 +1056,32 @@ el_blockhead_t *el_find_first_avail(size_t size){
 // parameter size. Does not do any linking of blocks.  If the
 // parameter block does not have sufficient size for a split (at least
 // new_size + EL_BLOCK_OVERHEAD for the new header/footer) makes no
-// changes and returns NULL.
+// changes and returns NULL. The new block starts out available but
+// its state should still be set with el_set_state() by the caller.
 el_blockhead_t *el_split_block(el_blockhead_t *block, size_t new_size){
   //block is too small to do anything
-  if(block->size < new_size + EL_BLOCK_OVERHEAD)
+  if(EL_SIZE(block) < new_size + EL_BLOCK_OVERHEAD + EL_MIN_SIZE)
   {
     return NULL;
   }
   //for calculating the remaining size
-  size_t oldSize = block->size;
+  size_t oldSize = EL_SIZE(block);
   //updating the size of the block to be what was malloc'd
-  block->size = new_size;
+  el_set_size(block, new_size);
   //the leftovers will be set to the reamining size
   size_t remainingSize = oldSize - new_size;
   //matching the new blocks size in the foot
-  el_blockfoot_t *footold = el_get_footer(block);
-  footold->size = new_size;
+  el_sync_footer(block);
   //matching the leftover block's size with remaining size
   el_blockhead_t *newHeader = el_block_above(block);
-  newHeader->size = remainingSize - EL_BLOCK_OVERHEAD;
-  el_blockfoot_t *footnew = el_get_footer(newHeader);
-  footnew->size = remainingSize - EL_BLOCK_OVERHEAD;
-  //we turned 1 block into 2 so you need to increment length
-  el_ctl.avail->length++;
+#ifdef EL_COMPACT_HEADERS
+  newHeader->size = EL_STATE(block) == EL_AVAILABLE ? EL_PREV_FREE_BIT : 0;
+#else
+  newHeader->state = EL_AVAILABLE;
+#endif
+  el_set_size(newHeader, remainingSize - EL_BLOCK_OVERHEAD);
+  el_sync_footer(newHeader);
+  el_ctl.stats.splits++;
   return newHeader;
 }
 
@@ -310,46 +1090,391 @@ el_blockhead_t *el_split_block(el_blockhead_t *block, size_t new_size){
 // for use by the user.  The pointer returned is to the usable space,
 // not the block header. Makes use of find_first_avail() to find a
 // suitable block and el_split_block() to split it.  Returns NULL if
-// no space is available.
+// no space is available. Requests of at least the mmap threshold get
+// a mapping of their own instead, see el_set_mmap_threshold().
 void *el_malloc(size_t nbytes){
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  void *ptr = el_do_malloc(nbytes);
+  el_trace_end(&mark, EL_TRACE_MALLOC, nbytes, ptr);
+  return ptr;
+}
+
+// Untraced body of el_malloc() which other allocator functions call
+// so that their work is not traced twice.
+static void *el_do_malloc(size_t nbytes){
+  el_count_request(nbytes);
+  //huge blocks would only fragment the heap
+  if(el_ctl.mmap_threshold != 0 && nbytes >= el_ctl.mmap_threshold){
+    return el_mmap_block(nbytes, EL_ALIGN);
+  }
+  //requests bigger than the heap can never succeed and would overflow below
+  if(nbytes > el_ctl.heap_bytes){
+    return el_mmap_block(nbytes, EL_ALIGN);
+  }
+  nbytes = el_request_size(nbytes);
+  //a recently freed block of this size needs no search or split
+  el_blockhead_t *myHead = el_quick_pop(nbytes);
+  if(myHead != NULL)
+  {
+    el_add_used(myHead);
+    el_ctl.stats.allocs++;
+    el_count_used();
+    return PTR_PLUS_BYTES(myHead, EL_HEADER_BYTES);
+  }
   //finding space
-  el_blockhead_t *myHead = el_find_first_avail(nbytes);
+  myHead = el_find_first_avail(nbytes);
+  //blocks held on quick lists may merge into enough space
+  if(myHead == NULL && el_ctl.quick_blocks > 0)
+  {
+    el_flush_quick_lists();
+    myHead = el_find_first_avail(nbytes);
+  }
   //checking to make sure there is space availible
   if(myHead == NULL)
   {
-    return NULL;
+    return el_mmap_block(nbytes, EL_ALIGN);
   }
+  //take the block off the available list before its size changes
+  el_remove_block(el_ctl.avail, myHead);
   //attempting to split
   el_blockhead_t *newHead = el_split_block(myHead, nbytes);
-  //if the split was successful you have to update the pointers
+  //if the split was successful the leftovers go back on the front of avail
   if(newHead != NULL)
   {
-    myHead->next->prev = newHead;
-    newHead->next = myHead->next;
-    myHead->next = newHead;
-    newHead->prev = myHead;
-    //removing both blocks
-    el_remove_block(el_ctl.avail, myHead);
-    el_remove_block(el_ctl.avail, newHead);
-    //adding back to the front of the list
+    el_set_state(newHead, EL_AVAILABLE);
     el_add_block_front(el_ctl.avail, newHead);
-    //updating the states
-    newHead->state = EL_AVAILABLE;
-    myHead->state = EL_USED;
-    //putting the malloc'd stuff in used
-    el_add_block_front(el_ctl.used, myHead);
-    //returning the usable block not the head
-    return PTR_PLUS_BYTES(myHead, sizeof(el_blockhead_t));
   }
-  else
-  {
-    //you still wanna do this stuff
-    myHead->state = EL_USED;
-    el_remove_block(el_ctl.avail, myHead);
-    el_add_block_front(el_ctl.used, myHead);
-    //returning the usable block not the head
-    return PTR_PLUS_BYTES(myHead, sizeof(el_blockhead_t));
+  //updating the state and putting the malloc'd stuff in used
+  el_set_state(myHead, EL_USED);
+  el_add_used(myHead);
+  el_mark_touched(myHead);
+  el_ctl.stats.allocs++;
+  el_count_used();
+  //returning the usable block not the head
+  return PTR_PLUS_BYTES(myHead, EL_HEADER_BYTES);
+}
+
+// Return pointer to zeroed memory for an array of nmemb elements of
+// the given size or NULL if the total size overflows or no space is
+// available. Blocks handed out from the part of the heap that has
+// never been given to a user are still zero from the calloc() in
+// el_init() so the memset() is skipped for them, as it is for blocks
+// in new mappings.
+void *el_calloc(size_t nmemb, size_t size){
+  if(size != 0 && nmemb > ((size_t) -1) / size){
+    return NULL;
   }
+  size_t nbytes = nmemb * size;
+  //remember where untouched memory started before this allocation moves it
+  void *untouched = el_ctl.untouched;
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  void *ptr = el_do_malloc(nbytes);
+  el_trace_end(&mark, EL_TRACE_CALLOC, nbytes, ptr);
+  if(ptr == NULL){
+    return NULL;
+  }
+  el_blockhead_t *head = PTR_MINUS_BYTES(ptr, EL_HEADER_BYTES);
+  //fresh mappings are zero already
+  if(EL_IS_MMAPPED(head)){
+    return ptr;
+  }
+  if((void *) head < untouched){
+    memset(ptr, 0, nbytes);
+  }
+#ifdef EL_COMPACT_HEADERS
+  else{
+    //the links and footer it had while available live in the payload
+    memset(ptr, 0, 2*sizeof(void *));
+    el_get_footer(head)->size = 0;
+  }
+#endif
+  return ptr;
+}
+
+// Return a pointer to nbytes whose address is a multiple of
+// alignment, which must be a power of two, or NULL if it is not or no
+// space is available. The available list is searched first fit for a
+// block with room for an aligned payload rather than over-allocating
+// by the alignment: the slack below the payload becomes an available
+// block of its own and any excess above is split off as el_malloc()
+// does, so padding is never left inside the block. The result is an
+// ordinary block for el_free() and el_realloc(), though el_realloc()
+// may move it to a less aligned address. Alignments up to EL_ALIGN
+// are plain el_malloc() calls.
+void *el_aligned_alloc(size_t alignment, size_t nbytes){
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  void *ptr = el_do_aligned_alloc(alignment, nbytes);
+  el_trace_end(&mark, EL_TRACE_ALIGNED_ALLOC, nbytes, ptr);
+  return ptr;
+}
+
+// Find the first available block with room for a payload of size
+// bytes at a multiple of alignment. Sets lead to the bytes between
+// the block's header and the header of the aligned block, either 0
+// or enough for the slack to form a block of its own.
+static el_blockhead_t *el_find_aligned_avail(size_t size, size_t alignment, size_t *lead){
+  size_t steps = 0;
+  el_blockhead_t *block = EL_NEXT(el_ctl.avail->beg);
+  for(; steps < el_ctl.avail->length; block = EL_NEXT(block)){
+    steps++;
+    size_t payload = (size_t) PTR_PLUS_BYTES(block, EL_HEADER_BYTES);
+    size_t gap = (alignment - payload % alignment) % alignment;
+    while(gap != 0 && gap < EL_BLOCK_OVERHEAD + EL_MIN_SIZE){
+      gap += alignment;
+    }
+    if(gap + size <= EL_SIZE(block)){
+      el_count_search(steps);
+      *lead = gap;
+      return block;
+    }
+  }
+  el_count_search(steps);
+  return NULL;
+}
+
+// Untraced body of el_aligned_alloc().
+static void *el_do_aligned_alloc(size_t alignment, size_t nbytes){
+  if(alignment == 0 || (alignment & (alignment-1)) != 0){
+    el_ctl.stats.failed++;
+    return NULL;
+  }
+  if(alignment <= EL_ALIGN){
+    return el_do_malloc(nbytes);
+  }
+  el_count_request(nbytes);
+  if(el_ctl.mmap_threshold != 0 && nbytes >= el_ctl.mmap_threshold){
+    return el_mmap_block(nbytes, alignment);
+  }
+  if(nbytes > el_ctl.heap_bytes || alignment > el_ctl.heap_bytes){
+    return el_mmap_block(nbytes, alignment);
+  }
+  size_t size = el_request_size(nbytes);
+  size_t lead = 0;
+  el_blockhead_t *block = el_find_aligned_avail(size, alignment, &lead);
+  if(block == NULL && el_ctl.quick_blocks > 0){
+    el_flush_quick_lists();
+    block = el_find_aligned_avail(size, alignment, &lead);
+  }
+  if(block == NULL){
+    return el_mmap_block(nbytes, alignment);
+  }
+  el_remove_block(el_ctl.avail, block);
+  //the slack below the aligned payload stays available
+  if(lead > 0){
+    el_blockhead_t *aligned = el_split_block(block, lead - EL_BLOCK_OVERHEAD);
+    el_add_block_front(el_ctl.avail, block);
+    block = aligned;
+  }
+  el_blockhead_t *tail = el_split_block(block, size);
+  if(tail != NULL){
+    el_set_state(tail, EL_AVAILABLE);
+    el_add_block_front(el_ctl.avail, tail);
+  }
+  el_set_state(block, EL_USED);
+  el_add_used(block);
+  el_mark_touched(block);
+  el_ctl.stats.allocs++;
+  el_count_used();
+  return PTR_PLUS_BYTES(block, EL_HEADER_BYTES);
+}
+
+// Allocate count blocks of nbytes each, storing pointers to them in
+// ptrs, and return the number allocated. The blocks are carved one
+// after another from the first available block big enough to hold
+// them all, so the available list is searched and relinked once for
+// the whole batch instead of once per block. When no block is that
+// big the rest of the batch is carved from whichever blocks fit at
+// least one. If the heap runs out fewer than count blocks are
+// allocated and the unused entries of ptrs are set to NULL. Each
+// block is an ordinary allocation that may be passed to el_free() or
+// el_free_batch().
+size_t el_malloc_batch(size_t nbytes, size_t count, void **ptrs){
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  size_t done = el_do_malloc_batch(nbytes, count, ptrs);
+  el_trace_end(&mark, EL_TRACE_MALLOC_BATCH, nbytes*done, done == 0 ? NULL : ptrs[0]);
+  return done;
+}
+
+// Untraced body of el_malloc_batch().
+static size_t el_do_malloc_batch(size_t nbytes, size_t count, void **ptrs){
+  size_t done = 0;
+  size_t size = 0;
+  size_t stride = 0;
+  if(nbytes <= el_ctl.heap_bytes){
+    size = el_request_size(nbytes);
+    stride = size + EL_BLOCK_OVERHEAD;
+  }
+  while(stride != 0 && done < count){
+    //first look for one block holding everything that is left
+    size_t want = count - done;
+    el_blockhead_t *block = NULL;
+    if(want > 1 && want <= el_ctl.heap_bytes / stride){
+      block = el_find_first_avail(want*stride - EL_BLOCK_OVERHEAD);
+    }
+    if(block == NULL){
+      block = el_find_first_avail(size);
+    }
+    if(block == NULL && el_ctl.quick_blocks > 0){
+      el_flush_quick_lists();
+      continue;
+    }
+    if(block == NULL){
+      break;
+    }
+    el_remove_block(el_ctl.avail, block);
+    size_t fits = (EL_SIZE(block) + EL_BLOCK_OVERHEAD) / stride;
+    if(fits > want){
+      fits = want;
+    }
+    //peel blocks off the bottom; the last one keeps any slack too small to split
+    for(size_t i=0; i<fits && block != NULL; i++){
+      el_blockhead_t *rest = el_split_block(block, size);
+      el_set_state(block, EL_USED);
+      el_add_used(block);
+      el_mark_touched(block);
+      el_count_request(nbytes);
+      el_ctl.stats.allocs++;
+      ptrs[done++] = PTR_PLUS_BYTES(block, EL_HEADER_BYTES);
+      block = rest;
+    }
+    if(block != NULL){
+      el_set_state(block, EL_AVAILABLE);
+      el_add_block_front(el_ctl.avail, block);
+    }
+  }
+  el_count_used();
+  if(done < count){
+    el_ctl.stats.failed++;
+    for(size_t i=done; i<count; i++){
+      ptrs[i] = NULL;
+    }
+  }
+  return done;
+}
+
+// Change the size of the block at ptr to nbytes, returning a pointer
+// to the possibly moved block or NULL on failure in which case the
+// original block is unchanged. Follows the usual realloc()
+// conventions: a NULL ptr behaves like el_malloc() and nbytes of 0
+// behaves like el_free(). Shrinking splits the tail off as a new
+// available block. Growing first tries to absorb an available block
+// above and/or below before falling back to allocate/copy/free. When
+// the block below is absorbed, the data moves down with memmove().
+// A block in a mapping of its own is resized with mremap() or moved
+// into the heap once it is smaller than the mmap threshold.
+void *el_realloc(void *ptr, size_t nbytes){
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  void *newPtr = el_do_realloc(ptr, nbytes);
+  el_trace_end(&mark, EL_TRACE_REALLOC, nbytes, newPtr);
+  return newPtr;
+}
+
+// Return the number of bytes usable at ptr which was returned by
+// one of the allocation functions; at least the number requested.
+size_t el_usable_size(void *ptr){
+  el_blockhead_t *head = PTR_MINUS_BYTES(ptr, EL_HEADER_BYTES);
+  return EL_SIZE(head);
+}
+
+// Untraced body of el_realloc().
+static void *el_do_realloc(void *ptr, size_t nbytes){
+  if(ptr == NULL){
+    return el_do_malloc(nbytes);
+  }
+  if(nbytes == 0){
+    el_do_free(ptr);
+    return NULL;
+  }
+  el_ctl.stats.reallocs++;
+  el_blockhead_t *head = PTR_MINUS_BYTES(ptr, EL_HEADER_BYTES);
+  if(EL_IS_MMAPPED(head)){
+    return el_mremap_block(head, nbytes);
+  }
+  size_t oldSize = EL_SIZE(head);
+  //too big for the heap: move it to a mapping
+  if(nbytes > el_ctl.heap_bytes){
+    void *newPtr = el_do_malloc(nbytes);
+    if(newPtr == NULL){
+      return NULL;
+    }
+    memcpy(newPtr, ptr, oldSize);
+    el_do_free(ptr);
+    return newPtr;
+  }
+  nbytes = el_request_size(nbytes);
+
+  //already big enough: give back the tail if there is room for a block
+  if(nbytes <= oldSize){
+    if(oldSize >= nbytes + EL_BLOCK_OVERHEAD + EL_MIN_SIZE){
+      el_remove_used(head);
+      el_blockhead_t *tail = el_split_block(head, nbytes);
+      el_add_used(head);
+      el_set_state(tail, EL_AVAILABLE);
+      el_add_block_front(el_ctl.avail, tail);
+      el_merge_block_with_above(tail);
+    }
+    return ptr;
+  }
+
+  //see how much room the free neighbors would give
+  el_blockhead_t *above = el_block_above(head);
+  el_blockhead_t *below = el_block_below(head);
+  if(above != NULL && EL_STATE(above) != EL_AVAILABLE){
+    above = NULL;
+  }
+  if(below != NULL && EL_STATE(below) != EL_AVAILABLE){
+    below = NULL;
+  }
+  size_t aboveSize = above == NULL ? 0 : EL_SIZE(above) + EL_BLOCK_OVERHEAD;
+  size_t belowSize = below == NULL ? 0 : EL_SIZE(below) + EL_BLOCK_OVERHEAD;
+  if(oldSize + aboveSize < nbytes){
+    //above alone is not enough, only worth moving down if below makes up the rest
+    if(below == NULL || oldSize + aboveSize + belowSize < nbytes){
+      void *newPtr = el_do_malloc(nbytes);
+      if(newPtr == NULL){
+        return NULL;
+      }
+      memcpy(newPtr, ptr, oldSize);
+      el_do_free(ptr);
+      return newPtr;
+    }
+  }
+  else{
+    //no need to move data when above suffices
+    below = NULL;
+    belowSize = 0;
+  }
+
+  el_remove_used(head);
+  if(above != NULL){
+    el_remove_block(el_ctl.avail, above);
+    el_ctl.stats.merges++;
+  }
+  if(below != NULL){
+    el_remove_block(el_ctl.avail, below);
+    el_ctl.stats.merges++;
+    memmove(PTR_PLUS_BYTES(below, EL_HEADER_BYTES), ptr, oldSize);
+    head = below;
+  }
+  el_set_size(head, oldSize + aboveSize + belowSize);
+  el_set_state(head, EL_USED);
+  el_sync_footer(head);
+
+  //return any excess beyond the request to the available list
+  el_blockhead_t *tail = el_split_block(head, nbytes);
+  if(tail != NULL){
+    el_set_state(tail, EL_AVAILABLE);
+    el_add_block_front(el_ctl.avail, tail);
+  }
+  el_add_used(head);
+  el_mark_touched(head);
+  el_count_used();
+  return PTR_PLUS_BYTES(head, EL_HEADER_BYTES);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -368,7 +1493,7 @@ void *el_malloc(size_t nbytes){
 // list.
 void el_merge_block_with_above(el_blockhead_t *lower){
   //doing these checks to make sure I don't call my helper functions withh an invalid address
-  if(lower == NULL || lower->state == EL_USED)
+  if(lower == NULL || EL_STATE(lower) == EL_USED)
   {
     return;
   }
@@ -378,17 +1503,17 @@ void el_merge_block_with_above(el_blockhead_t *lower){
   el_remove_block(el_ctl.avail, lower);
   if((higher != NULL))
   {
-    if(higher->state == EL_AVAILABLE)
+    if(EL_STATE(higher) == EL_AVAILABLE)
     {
       // we know we're merging so now we can remove higher from avail
       el_remove_block(el_ctl.avail, higher);
       //what the new size will be
-      size_t sizeAddition = higher->size + EL_BLOCK_OVERHEAD;
+      size_t sizeAddition = EL_SIZE(higher) + EL_BLOCK_OVERHEAD;
       //updating size
-      lower->size += sizeAddition;
+      el_set_size(lower, EL_SIZE(lower) + sizeAddition);
       //updating size in the new foot
-      el_blockfoot_t *highfoot = el_get_footer(higher);
-      highfoot->size = lower->size;
+      el_sync_footer(lower);
+      el_ctl.stats.merges++;
     }
   }
   //we still wanna add this to the front
@@ -401,21 +1526,458 @@ void el_merge_block_with_above(el_blockhead_t *lower){
 // on the block size. Attempts to merge the free'd block with adjacent
 // blocks using el_merge_block_with_above().
 void el_free(void *ptr){
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  el_do_free(ptr);
+  el_trace_end(&mark, EL_TRACE_FREE, 0, ptr);
+}
+
+// Untraced body of el_free(). Like free(), a NULL ptr does nothing.
+// Small blocks go on a quick list when those are on, otherwise the
+// block is made available by el_release_block().
+static void el_do_free(void *ptr){
+  if(ptr == NULL || el_ctl.bump){
+    return;
+  }
   //getting the head of what we want to free
-  el_blockhead_t *head = PTR_MINUS_BYTES(ptr, sizeof(el_blockhead_t));
-  //getting the block below so we can also merge with below if possible
-  el_blockhead_t *underhead = el_block_below(head);
+  el_blockhead_t *head = PTR_MINUS_BYTES(ptr, EL_HEADER_BYTES);
+  if(EL_IS_MMAPPED(head))
+  {
+    el_free_mmapped(head);
+    return;
+  }
   //making sure what we want to free isn't already free
-  if(head->state == EL_AVAILABLE)
+  if(EL_STATE(head) == EL_AVAILABLE)
+  {
+    return;
+  }
+  //a block on a quick list still looks in use; catch it being freed twice in a row
+  int quick = el_quick_fits(EL_SIZE(head));
+  if(quick && el_ctl.quick[EL_SIZE(head) / EL_QUICK_SPACING] == head)
   {
     return;
   }
   //actually freeing the block
-  el_remove_block(el_ctl.used, head );
+  el_ctl.stats.frees++;
+  el_remove_used(head);
+  if(quick)
+  {
+    el_quick_push(head);
+    return;
+  }
+  el_release_block(head);
+}
+
+// Make an in-use block that is on no list available, merging it with
+// available neighbors.
+static void el_release_block(el_blockhead_t *head){
+  //getting the block below so we can also merge with below if possible
+  el_blockhead_t *underhead = el_block_below(head);
   el_add_block_front(el_ctl.avail, head);
   //changing state
-  head->state = EL_AVAILABLE;
+  el_set_state(head, EL_AVAILABLE);
   //trying to merge with both above and below
   el_merge_block_with_above(head);
   el_merge_block_with_above(underhead);
 }
+
+// Free the count blocks pointed to by ptrs, which may include NULLs
+// and need not be in any order. Blocks are first all marked available
+// and then each run of adjacent available blocks is merged into one
+// block and put on the available list, so the list is touched once
+// per run rather than once or more per block as el_free() would. Runs
+// are found by walking neighbors in memory instead of sorting ptrs,
+// keeping the whole batch linear in count. Blocks in mappings of
+// their own are unmapped in the second pass.
+void el_free_batch(void **ptrs, size_t count){
+  el_trace_mark_t mark;
+  el_trace_begin(&mark);
+  el_do_free_batch(ptrs, count);
+  el_trace_end(&mark, EL_TRACE_FREE_BATCH, 0, count == 0 ? NULL : ptrs[0]);
+}
+
+// Untraced body of el_free_batch(). A block marked available but not
+// yet on the available list has a NULL next link; every block on the
+// list has a non-NULL one.
+static void el_do_free_batch(void **ptrs, size_t count){
+  if(el_ctl.bump){
+    return;
+  }
+  for(size_t i=0; i<count; i++){
+    el_blockhead_t *head = ptrs[i] == NULL ? NULL : PTR_MINUS_BYTES(ptrs[i], EL_HEADER_BYTES);
+    //already free blocks are skipped like el_free() does, mapped ones wait
+    if(head == NULL || EL_IS_MMAPPED(head) || EL_STATE(head) == EL_AVAILABLE){
+      continue;
+    }
+    el_remove_used(head);
+    el_set_state(head, EL_AVAILABLE);
+    el_sync_footer(head);
+    EL_SET_NEXT(head, NULL);
+    el_ctl.stats.frees++;
+  }
+  for(size_t i=0; i<count; i++){
+    el_blockhead_t *head = ptrs[i] == NULL ? NULL : PTR_MINUS_BYTES(ptrs[i], EL_HEADER_BYTES);
+    if(head != NULL && EL_IS_MMAPPED(head)){
+      el_free_mmapped(head);
+      continue;
+    }
+    //skip blocks whose run has been merged already
+    if(head == NULL || EL_NEXT(head) != NULL){
+      continue;
+    }
+    //find the bottom of the run then take in every available block above it
+    el_blockhead_t *start = head;
+    el_blockhead_t *below = el_block_below(start);
+    for(; below != NULL && EL_STATE(below) == EL_AVAILABLE; below = el_block_below(start)){
+      start = below;
+    }
+    size_t bytes = 0;
+    el_blockhead_t *block = start;
+    for(; block != NULL && EL_STATE(block) == EL_AVAILABLE; block = el_block_above(block)){
+      if(EL_NEXT(block) != NULL){
+        el_remove_block(el_ctl.avail, block);
+      }
+      else{
+        EL_SET_NEXT(block, el_ctl.avail->end);
+      }
+      if(block != start){
+        el_ctl.stats.merges++;
+      }
+      bytes += EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+    }
+    el_set_size(start, bytes - EL_BLOCK_OVERHEAD);
+    el_set_state(start, EL_AVAILABLE);
+    el_sync_footer(start);
+    el_add_block_front(el_ctl.avail, start);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Quick lists
+
+// Turn on quick lists: freed blocks of up to max_size bytes are kept
+// in use on a LIFO list per size, at most max_count per list, instead
+// of being merged into the available list. el_malloc() of a size
+// with a non-empty list pops it without searching or splitting.
+// Merging is deferred until a list overflows or an allocation fails,
+// when all lists are flushed. max_size is capped to what
+// EL_QUICK_BINS lists cover; a max_count of 0 turns quick lists off.
+// Call after el_init().
+void el_set_quick_limits(size_t max_size, size_t max_count){
+  el_flush_quick_lists();
+  if(max_size >= EL_QUICK_BINS*EL_QUICK_SPACING){
+    max_size = EL_QUICK_BINS*EL_QUICK_SPACING - 1;
+  }
+  el_ctl.quick_max = max_size;
+  el_ctl.quick_count = max_count;
+}
+
+// Release every block on the quick lists to the available list,
+// merging each with its available neighbors.
+void el_flush_quick_lists(){
+  if(el_ctl.quick_blocks == 0){
+    return;
+  }
+  for(int i=0; i<EL_QUICK_BINS; i++){
+    el_flush_quick_list(i);
+  }
+}
+
+// Release the blocks on one quick list to the available list.
+static void el_flush_quick_list(int bin){
+  el_blockhead_t *block = el_ctl.quick[bin];
+  if(block == NULL){
+    return;
+  }
+  //blocks come off one at a time so a heap file's copy of the list
+  //never holds a released block
+  while(block != NULL){
+    el_blockhead_t *next = EL_NEXT(block);
+    el_ctl.quick[bin] = next;
+    el_ctl.quick_length[bin]--;
+    el_ctl.quick_blocks--;
+    el_ctl.quick_bytes -= EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+    el_quick_save(bin);
+    el_release_block(block);
+    block = next;
+  }
+  el_ctl.stats.quick_flushes++;
+}
+
+// Whether freed blocks of the given size go on a quick list.
+static int el_quick_fits(size_t size){
+  return el_ctl.quick_count > 0 && size <= el_ctl.quick_max;
+}
+
+// Take a block of at least size bytes from the top of its quick list
+// or return NULL. Only the top is checked: a list holds sizes within
+// EL_QUICK_SPACING of each other and one size usually dominates.
+static el_blockhead_t *el_quick_pop(size_t size){
+  if(!el_quick_fits(size)){
+    return NULL;
+  }
+  int bin = size / EL_QUICK_SPACING;
+  el_blockhead_t *block = el_ctl.quick[bin];
+  if(block == NULL || EL_SIZE(block) < size){
+    return NULL;
+  }
+  el_ctl.quick[bin] = EL_NEXT(block);
+  el_ctl.quick_length[bin]--;
+  el_ctl.quick_blocks--;
+  el_ctl.quick_bytes -= EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+  el_ctl.stats.quick_hits++;
+  el_quick_save(bin);
+  return block;
+}
+
+// Push a block that is still in use but on no list onto its quick
+// list, flushing that list first if it is full.
+static void el_quick_push(el_blockhead_t *block){
+  int bin = EL_SIZE(block) / EL_QUICK_SPACING;
+  if(el_ctl.quick_length[bin] >= el_ctl.quick_count){
+    el_flush_quick_list(bin);
+  }
+  EL_SET_NEXT(block, el_ctl.quick[bin]);
+  el_ctl.quick[bin] = block;
+  el_ctl.quick_length[bin]++;
+  el_ctl.quick_blocks++;
+  el_ctl.quick_bytes += EL_SIZE(block) + EL_BLOCK_OVERHEAD;
+  el_quick_save(bin);
+}
+
+// Copy the top and length of a quick list to the heap file header, if
+// any, so el_init_file() can release its blocks after a crash.
+static void el_quick_save(int bin){
+  el_file_header_t *file = el_ctl.heap_file;
+  if(file != NULL){
+    file->quick[bin] = EL_LINK_OF(el_ctl.quick[bin]);
+    file->quick_length[bin] = el_ctl.quick_length[bin];
+  }
+}
+
+// el_quick_save() every quick list.
+static void el_quick_save_all(){
+  for(int bin=0; bin<EL_QUICK_BINS; bin++){
+    el_quick_save(bin);
+  }
+}
+
+// Whether the block is on a quick list. Walks its list so is only
+// meant for printing.
+static int el_on_quick_list(el_blockhead_t *block){
+  if(!el_quick_fits(EL_SIZE(block))){
+    return 0;
+  }
+  el_blockhead_t *quick = el_ctl.quick[EL_SIZE(block) / EL_QUICK_SPACING];
+  for(; quick != NULL; quick = EL_NEXT(quick)){
+    if(quick == block){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Huge blocks
+
+// Set the mmap threshold: el_malloc() gives requests of at least
+// nbytes a mapping of their own, outside the heap, which el_free()
+// unmaps. Huge blocks then neither use up nor fragment the heap and
+// their memory goes back to the system as soon as they are freed. A
+// request the heap cannot hold is also mapped when it is at least
+// EL_MMAP_THRESHOLD bytes. An nbytes of 0 turns mapping off.
+//
+// Until this is called the threshold starts at EL_MMAP_THRESHOLD and
+// adapts as glibc's does: freeing a mapped block larger than the
+// threshold, but no larger than EL_MMAP_THRESHOLD_MAX, raises the
+// threshold to its size, so a program that keeps allocating and
+// freeing blocks of that size gets them from the heap without a
+// system call each time. Setting the threshold fixes it. Heap files
+// cannot keep mapped blocks so their threshold is 0 and should stay
+// so. Call after el_init().
+void el_set_mmap_threshold(size_t nbytes){
+  el_ctl.mmap_threshold = nbytes;
+  el_ctl.mmap_dynamic = 0;
+}
+
+// System page size.
+static size_t el_page_bytes(){
+  static size_t page = 0;
+  if(page == 0){
+    page = sysconf(_SC_PAGESIZE);
+  }
+  return page;
+}
+
+// Round nbytes up to whole pages, or return 0 if that overflows.
+static size_t el_mmap_round(size_t nbytes){
+  size_t page = el_page_bytes();
+  if(nbytes > ((size_t) -1) - page){
+    return 0;
+  }
+  return (nbytes + page - 1) / page * page;
+}
+
+// Bytes mapped for the block at head.
+static size_t el_mmap_length(el_blockhead_t *head){
+  el_mmap_chunk_t *chunk = PTR_MINUS_BYTES(head, EL_MMAP_PAD);
+  return chunk->lead + EL_MMAP_PAD + EL_HEADER_BYTES + EL_SIZE(head);
+}
+
+// Add a mapping to the front of the arena's list and return the
+// header of its block.
+static el_blockhead_t *el_mmap_link(el_mmap_chunk_t *chunk){
+  chunk->prev = NULL;
+  chunk->next = el_ctl.mmapped;
+  if(chunk->next != NULL){
+    chunk->next->prev = chunk;
+  }
+  el_ctl.mmapped = chunk;
+  return PTR_PLUS_BYTES(chunk, EL_MMAP_PAD);
+}
+
+// Take a mapping off the arena's list.
+static void el_mmap_unlink(el_mmap_chunk_t *chunk){
+  if(chunk->prev != NULL){
+    chunk->prev->next = chunk->next;
+  }
+  else{
+    el_ctl.mmapped = chunk->next;
+  }
+  if(chunk->next != NULL){
+    chunk->next->prev = chunk->prev;
+  }
+}
+
+// Allocate a block of at least nbytes in a mapping of its own with
+// its payload a multiple of alignment and return the payload. Also
+// called when the heap cannot serve a request so fails, returning
+// NULL, for requests under both the threshold and EL_MMAP_THRESHOLD,
+// when mapping is off or when the mapping cannot be made. The pages
+// are zero and untouched until written.
+static void *el_mmap_block(size_t nbytes, size_t alignment){
+  size_t extra = alignment > EL_ALIGN ? alignment : 0;
+  size_t length = 0;
+  if(el_ctl.mmap_threshold != 0 &&
+     (nbytes >= el_ctl.mmap_threshold || nbytes >= EL_MMAP_THRESHOLD) &&
+     nbytes <= ((size_t) -1) - EL_MMAP_PAD - EL_HEADER_BYTES - extra){
+    length = el_mmap_round(EL_MMAP_PAD + EL_HEADER_BYTES + nbytes + extra);
+  }
+  void *map = length == 0 ? MAP_FAILED :
+    mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(map == MAP_FAILED){
+    el_ctl.stats.failed++;
+    return NULL;
+  }
+  size_t lead = 0;
+  if(extra > 0){
+    //over-mapped by alignment; give back the whole pages either side
+    size_t payload = (size_t) map + EL_MMAP_PAD + EL_HEADER_BYTES;
+    lead = (alignment - payload % alignment) % alignment;
+    size_t trim = lead / el_page_bytes() * el_page_bytes();
+    size_t keep = el_mmap_round(lead - trim + EL_MMAP_PAD + EL_HEADER_BYTES + nbytes);
+    if(trim > 0){
+      munmap(map, trim);
+    }
+    if(trim + keep < length){
+      munmap(PTR_PLUS_BYTES(map, trim + keep), length - trim - keep);
+    }
+    map = PTR_PLUS_BYTES(map, trim);
+    lead -= trim;
+    length = keep;
+  }
+  el_mmap_chunk_t *chunk = PTR_PLUS_BYTES(map, lead);
+  chunk->lead = lead;
+  el_blockhead_t *head = el_mmap_link(chunk);
+#ifdef EL_COMPACT_HEADERS
+  head->size = (length - lead - EL_MMAP_PAD - EL_HEADER_BYTES) | EL_USED_BIT | EL_MMAPPED_BIT;
+#else
+  head->size = length - lead - EL_MMAP_PAD - EL_HEADER_BYTES;
+  head->state = EL_MMAPPED;
+#endif
+  el_ctl.mmap_blocks++;
+  el_ctl.mmap_bytes += length;
+  el_ctl.stats.mmaps++;
+  el_ctl.stats.allocs++;
+  return PTR_PLUS_BYTES(head, EL_HEADER_BYTES);
+}
+
+// Unmap the mapping holding the given block.
+static void el_munmap_block(el_blockhead_t *head){
+  el_mmap_chunk_t *chunk = PTR_MINUS_BYTES(head, EL_MMAP_PAD);
+  size_t length = el_mmap_length(head);
+  el_mmap_unlink(chunk);
+  el_ctl.mmap_blocks--;
+  el_ctl.mmap_bytes -= length;
+  el_ctl.stats.frees++;
+  munmap(PTR_MINUS_BYTES(chunk, chunk->lead), length);
+}
+
+// Free a block in a mapping of its own, first adapting the threshold
+// to its size.
+static void el_free_mmapped(el_blockhead_t *head){
+  size_t length = el_mmap_length(head);
+  if(el_ctl.mmap_dynamic && length > el_ctl.mmap_threshold &&
+     length <= EL_MMAP_THRESHOLD_MAX){
+    el_ctl.mmap_threshold = length;
+  }
+  el_munmap_block(head);
+}
+
+// Resize a block in a mapping of its own to nbytes. Blocks now under
+// the threshold, or any once mapping is off, move into the heap if it
+// has room; otherwise the mapping is resized, moving it only if it
+// cannot grow in place. Like el_realloc() generally this need not
+// keep an alignment beyond EL_ALIGN. Returns the new payload or NULL
+// with the block unchanged.
+static void *el_mremap_block(el_blockhead_t *head, size_t nbytes){
+  void *ptr = PTR_PLUS_BYTES(head, EL_HEADER_BYTES);
+  size_t oldSize = EL_SIZE(head);
+  if((el_ctl.mmap_threshold == 0 || nbytes < el_ctl.mmap_threshold) &&
+     nbytes <= el_ctl.heap_bytes){
+    void *newPtr = el_do_malloc(nbytes);
+    if(newPtr != NULL){
+      memcpy(newPtr, ptr, nbytes < oldSize ? nbytes : oldSize);
+      el_munmap_block(head);
+      return newPtr;
+    }
+  }
+  el_mmap_chunk_t *chunk = PTR_MINUS_BYTES(head, EL_MMAP_PAD);
+  size_t lead = chunk->lead;
+  size_t oldLength = el_mmap_length(head);
+  size_t length = 0;
+  if(nbytes <= ((size_t) -1) - lead - EL_MMAP_PAD - EL_HEADER_BYTES){
+    length = el_mmap_round(lead + EL_MMAP_PAD + EL_HEADER_BYTES + nbytes);
+  }
+  if(length == oldLength){
+    return ptr;
+  }
+  //the neighbors' links must not be left pointing at the old address
+  el_mmap_unlink(chunk);
+  void *map = length == 0 ? MAP_FAILED :
+    mremap(PTR_MINUS_BYTES(chunk, lead), oldLength, length, MREMAP_MAYMOVE);
+  if(map == MAP_FAILED){
+    el_mmap_link(chunk);
+    el_ctl.stats.failed++;
+    return NULL;
+  }
+  head = el_mmap_link(PTR_PLUS_BYTES(map, lead));
+  el_set_size(head, length - lead - EL_MMAP_PAD - EL_HEADER_BYTES);
+  el_ctl.mmap_bytes += length - oldLength;
+  return PTR_PLUS_BYTES(head, EL_HEADER_BYTES);
+}
+
+// Unmap every block in a mapping of its own without counting them as
+// freed, for el_reset() and el_cleanup().
+static void el_munmap_all(){
+  el_mmap_chunk_t *chunk = el_ctl.mmapped;
+  while(chunk != NULL){
+    el_mmap_chunk_t *next = chunk->next;
+    el_blockhead_t *head = PTR_PLUS_BYTES(chunk, EL_MMAP_PAD);
+    munmap(PTR_MINUS_BYTES(chunk, chunk->lead), el_mmap_length(head));
+    chunk = next;
+  }
+  el_ctl.mmapped = NULL;
+  el_ctl.mmap_blocks = 0;
+  el_ctl.mmap_bytes = 0;
+}
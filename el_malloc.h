@@ -1,6 +1,10 @@
 #ifndef EL_MALLOC_H
 #define EL_MALLOC_H 1
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // macro to add a byte offset to a pointer, arguments are a pointer
 // and a # of bytes (usually size_t)
 #define PTR_PLUS_BYTES(ptr,off) ((void *) (((size_t) (ptr)) + ((size_t) (off))))
@@ -16,10 +20,68 @@
 // defines to indicate if a block is available or used
 #define EL_AVAILABLE     'a'    // block state indicating available
 #define EL_USED          'u'    // block state indicating in use
+#define EL_MMAPPED       'm'    // block state indicating in use with a mapping of its own
 #define EL_BEGIN_BLOCK   'B'    // block state indicating dummy beginning node in a list
 #define EL_END_BLOCK     'E'    // block state indicating dummy ending node in a list
 #define EL_UNINITIALIZED  0     // indication of uninitialized data
 
+// Building with EL_OFFSET_LINKS stores the next/prev links of blocks
+// as byte offsets from el_ctl.heap_start rather than pointers so that
+// a heap kept in a file can be mapped back at any address; see
+// el_init_file(). Links are read and written with EL_NEXT(),
+// EL_PREV(), EL_SET_NEXT() and EL_SET_PREV() which work either way.
+#ifdef EL_OFFSET_LINKS
+typedef size_t el_link_t;       // offset of the linked block from el_ctl.heap_start
+#define EL_NULL_LINK      ((size_t) -1)
+#define EL_LINK_OF(ptr)   ((ptr) == NULL ? EL_NULL_LINK : PTR_MINUS_PTR(ptr, el_ctl.heap_start))
+#define EL_LINKED(link)   ((link) == EL_NULL_LINK ? NULL : (el_blockhead_t *) PTR_PLUS_BYTES(el_ctl.heap_start, link))
+#else
+typedef struct block *el_link_t; // pointer to the linked block
+#define EL_NULL_LINK      NULL
+#define EL_LINK_OF(ptr)   (ptr)
+#define EL_LINKED(link)   (link)
+#endif
+#define EL_NEXT(block)          EL_LINKED((block)->next)
+#define EL_PREV(block)          EL_LINKED((block)->prev)
+#define EL_SET_NEXT(block,ptr)  ((block)->next = EL_LINK_OF(ptr))
+#define EL_SET_PREV(block,ptr)  ((block)->prev = EL_LINK_OF(ptr))
+
+// Building with EL_COMPACT_HEADERS selects a compact block layout:
+// the state lives in the low bits of the size, list links occupy the
+// payload only while a block is available and footers exist only on
+// available blocks. In-use blocks then carry 8 bytes of overhead and
+// payloads are aligned to EL_ALIGN bytes. Without it, every block has
+// the full header and footer below and sizes are not rounded.
+#ifdef EL_COMPACT_HEADERS
+
+// bits kept in the low bits of el_blockhead_t.size; sizes are always
+// a multiple of 8 so these are otherwise zero
+#define EL_USED_BIT       0x1   // block is in use
+#define EL_PREV_FREE_BIT  0x2   // block immediately below is available and has a footer
+#define EL_MMAPPED_BIT    0x4   // in-use block with a mapping of its own, outside the heap
+#define EL_FLAG_BITS      0x7   // mask of all bits that are not part of the size
+
+// Compact header. Only size is present on in-use blocks; next/prev
+// overlap the first bytes of the payload and are valid only while the
+// block is available.
+typedef struct block {
+  size_t size;                  // payload bytes | EL_USED_BIT | EL_PREV_FREE_BIT
+  el_link_t next;               // link to next block in same list, available blocks only
+  el_link_t prev;               // link to previous block in same list, available blocks only
+} el_blockhead_t;
+
+#define EL_HEADER_BYTES   (sizeof(size_t))                     // bytes ahead of the payload
+#define EL_BLOCK_OVERHEAD EL_HEADER_BYTES                      // bytes not usable by in-use blocks
+#define EL_ALIGN          16                                   // alignment of payloads
+#define EL_MIN_SIZE       (2*sizeof(void *) + sizeof(size_t))  // room for links and footer when freed
+#define EL_HEAP_PAD       (EL_ALIGN - EL_HEADER_BYTES)         // offset of the first header in the heap
+
+#define EL_SIZE(block)    ((block)->size & ~((size_t) EL_FLAG_BITS))
+#define EL_STATE(block)   (((block)->size & EL_USED_BIT) ? EL_USED : EL_AVAILABLE)
+#define EL_IS_MMAPPED(block) ((block)->size & EL_MMAPPED_BIT)
+
+#else
+
 // type which is a "header" for a block of memory; containts info on
 // size, whether the block is available or in use, and links to the
 // next/prev blocks in a doubly linked list. This data structure
@@ -28,22 +90,53 @@
 typedef struct block {
   size_t size;                  // number of bytes of memory in this block
   char state;                   // either EL_AVAILABLE or EL_USED
-  struct block *next;           // pointer to next block in same list
-  struct block *prev;           // pointer to previous block in same list
+  el_link_t next;               // link to next block in same list
+  el_link_t prev;               // link to previous block in same list
 } el_blockhead_t;
 
+#endif
+
 // Type for the "footer" of a block; indicates size of the preceding
 // block so that its header el_blockhead_t can be found with pointer
 // arithmetic. This data appears immediately after an area of memory
 // that may be used by a user or is free. Immediately after it is
 // either another header (el_blockhead_t) or the end of the heap.
+// In the compact layout it occupies the last bytes of the payload of
+// available blocks only.
 typedef struct {
   size_t size;
 } el_blockfoot_t;
 
+#ifndef EL_COMPACT_HEADERS
 // Size of tracking data for each block of data allocated which is a
 // combination of the size of the header and footer.
+#define EL_HEADER_BYTES   (sizeof(el_blockhead_t))
 #define EL_BLOCK_OVERHEAD (sizeof(el_blockhead_t) + sizeof(el_blockfoot_t))
+#define EL_ALIGN          1
+#define EL_MIN_SIZE       0
+#define EL_HEAP_PAD       0
+
+#define EL_SIZE(block)    ((block)->size)
+#define EL_STATE(block)   ((block)->state)
+#define EL_IS_MMAPPED(block) ((block)->state == EL_MMAPPED)
+#endif
+
+// Requests of at least the mmap threshold are given a mapping of
+// their own instead of heap space; see el_set_mmap_threshold(). The
+// block header in a mapping is preceded by an el_mmap_chunk_t linking
+// it to the others of its arena, which starts lead bytes into the
+// mapping; lead is 0 unless the block was aligned beyond EL_ALIGN by
+// el_aligned_alloc(). The threshold starts at EL_MMAP_THRESHOLD and
+// adapts to freed mapped blocks up to EL_MMAP_THRESHOLD_MAX.
+typedef struct el_mmap_chunk {
+  struct el_mmap_chunk *next;   // next mapping of the arena or NULL
+  struct el_mmap_chunk *prev;   // previous mapping of the arena or NULL
+  size_t lead;                  // bytes of the mapping before this
+} el_mmap_chunk_t;
+
+#define EL_MMAP_PAD           (sizeof(el_mmap_chunk_t))
+#define EL_MMAP_THRESHOLD     (128*1024)
+#define EL_MMAP_THRESHOLD_MAX (32*1024*1024)
 
 // Type for a list of blocks; doubly linked with a fixed
 // "dummy" node at the beginning and end which do not contain any
@@ -57,6 +150,97 @@ typedef struct {
   size_t bytes;                 // total bytes in list used including overhead; 
 } el_blocklist_t;
 // NOTE: total available bytes for use/in-use in the list is (bytes - length*EL_BLOCK_OVERHEAD)
+// NOTE: in the compact layout in-use blocks have no room for links so
+// the used list only tracks length and bytes; beg/end stay empty.
+
+// Number of buckets in the request size histogram of el_stats_t;
+// bucket i counts requests of [2^i, 2^(i+1)) bytes and the last
+// bucket also counts all larger requests.
+#define EL_HIST_BUCKETS 24
+
+// Quick lists hold recently freed small blocks for reuse by requests
+// of the same size; see el_set_quick_limits(). Blocks of size s go on
+// list s/EL_QUICK_SPACING so at most blocks smaller than
+// EL_QUICK_BINS*EL_QUICK_SPACING bytes can be kept.
+#define EL_QUICK_BINS    64
+#define EL_QUICK_SPACING 8
+
+// Allocator counters maintained on every call and returned by
+// el_get_stats() in constant time. The *_blocks/*_bytes fields are
+// copied from the lists when el_get_stats() is called.
+typedef struct {
+  size_t allocs;                // successful allocations including those made by el_realloc()
+  size_t frees;                 // blocks freed including those freed by el_realloc()
+  size_t reallocs;              // calls to el_realloc() that resized an existing block
+  size_t failed;                // allocations that returned NULL
+  size_t splits;                // blocks split by el_split_block()
+  size_t merges;                // adjacent available blocks merged
+  size_t searches;              // calls to el_find_first_avail()
+  size_t search_steps;          // blocks examined over all searches
+  size_t max_search_steps;      // most blocks examined by one search
+  size_t peak_bytes;            // highest used bytes including overhead
+  size_t quick_hits;            // allocations served from a quick list
+  size_t quick_flushes;         // times the quick lists were emptied onto the available list
+  size_t mmaps;                 // blocks given a mapping of their own
+  size_t hist[EL_HIST_BUCKETS]; // allocation requests by size
+  size_t used_blocks;           // blocks currently in use
+  size_t used_bytes;            // bytes currently in use including overhead
+  size_t avail_blocks;          // blocks currently available
+  size_t avail_bytes;           // bytes currently available including overhead
+  size_t quick_blocks;          // blocks currently on quick lists
+  size_t quick_bytes;           // bytes currently on quick lists including overhead
+  size_t mmap_blocks;           // blocks currently in mappings of their own
+  size_t mmap_bytes;            // bytes currently mapped for them
+  size_t mmap_threshold;        // current mmap threshold, 0 when off
+} el_stats_t;
+
+// operations recorded in el_trace_event_t
+#define EL_TRACE_MALLOC  'm'
+#define EL_TRACE_CALLOC  'c'
+#define EL_TRACE_REALLOC 'r'
+#define EL_TRACE_FREE    'f'
+#define EL_TRACE_MALLOC_BATCH 'M'     // nbytes is the total over the batch
+#define EL_TRACE_FREE_BATCH   'F'
+#define EL_TRACE_ALIGNED_ALLOC 'a'
+#define EL_TRACE_NO_OFFSET ((size_t) -1) // offset of a failed allocation or a mapped block
+
+// One sampled allocator call in the ring buffer given to
+// el_trace_start().
+typedef struct {
+  char op;                      // one of the EL_TRACE_* operations
+  size_t nbytes;                // bytes requested, 0 for frees
+  size_t offset;                // payload offset from heap_start or EL_TRACE_NO_OFFSET outside the heap
+  size_t steps;                 // blocks examined by el_find_first_avail() during the call
+  long nanos;                   // time spent in the call
+} el_trace_event_t;
+
+// Header at the start of a heap file made by el_init_file(); the
+// heap follows at offset header_bytes. The list sentinels live here
+// so the offsets linking them to blocks are the same wherever the
+// file is mapped. root, link_used and the quick lists are written
+// whenever they change; untouched and stats are only saved by
+// el_cleanup().
+typedef struct {
+  size_t magic;                 // EL_FILE_MAGIC
+  size_t version;               // EL_FILE_VERSION
+  size_t layout;                // block layout of the build that made the file
+  size_t clean;                 // 1 once el_cleanup() has saved the heap, 0 while in use
+  size_t header_bytes;          // bytes before heap_start, EL_FILE_HEADER_BYTES
+  size_t heap_bytes;            // el_ctl.heap_bytes
+  size_t heap_end;              // offset of el_ctl.heap_end from heap_start
+  size_t untouched;             // offset of el_ctl.untouched from heap_start
+  size_t root;                  // offset of the el_set_root() pointer, -1 for NULL
+  int link_used;                // el_ctl.link_used
+  el_blocklist_t avail;         // the available list
+  el_blocklist_t used;          // the used list
+  el_stats_t stats;             // el_ctl.stats
+  el_link_t quick[EL_QUICK_BINS];     // top block of each quick list
+  size_t quick_length[EL_QUICK_BINS]; // blocks on each quick list
+} el_file_header_t;
+
+#define EL_FILE_MAGIC        0x50414548464c45UL  // "ELFHEAP"
+#define EL_FILE_VERSION      3
+#define EL_FILE_HEADER_BYTES 4096                // header is padded to a page
 
 // Type for the global control of the allocator. Tracks heap size,
 // start and end addresses, total size, and lists of available and
@@ -65,36 +249,112 @@ typedef struct {
   void *heap_start;             // pointer to where the heap starts
   void *heap_end;               // pointer to where the heap ends; this memory address is out of bounds
   size_t heap_bytes;            // number of bytes currently in the heap
+  void *untouched;              // heap above this address has never been handed out and is still zero
   el_blocklist_t avail_actual;  // space for the available list data
   el_blocklist_t used_actual;   // space for the used list data
   el_blocklist_t *avail;        // pointer to avail_actual
   el_blocklist_t *used;         // pointer to used_actual
+  int link_used;                // 1 to link in-use blocks into used, 0 to only count them
+  el_blockhead_t *quick[EL_QUICK_BINS]; // LIFO lists of freed blocks linked through next
+  size_t quick_length[EL_QUICK_BINS];   // blocks on each quick list
+  size_t quick_max;             // largest block size put on a quick list
+  size_t quick_count;           // most blocks on one quick list, 0 when quick lists are off
+  size_t quick_blocks;          // blocks on all quick lists
+  size_t quick_bytes;           // bytes on all quick lists including overhead
+  el_stats_t stats;             // counters reported by el_get_stats()
+  el_trace_event_t *trace;      // ring buffer for sampled events or NULL when not tracing
+  size_t trace_capacity;        // number of events trace can hold
+  size_t trace_every;           // record one of every trace_every calls
+  size_t trace_calls;           // calls seen since tracing started
+  size_t trace_count;           // events recorded since tracing started
+  void *root;                   // pointer saved with a heap file, see el_set_root()
+  el_file_header_t *heap_file;  // header of a heap from el_init_file() or NULL
+  int bump;                     // 1 if frees are ignored until el_reset(), see el_set_bump()
+  el_mmap_chunk_t *mmapped;     // mappings of huge blocks, see el_set_mmap_threshold()
+  size_t mmap_threshold;        // requests of at least this many bytes are mapped, 0 for never
+  int mmap_dynamic;             // 1 while mmap_threshold adapts to freed mapped blocks
+  size_t mmap_blocks;           // blocks in mappings
+  size_t mmap_bytes;            // bytes in mappings including bookkeeping
 } el_ctl_t;
 
-// global control declared in el_malloc.c
-extern el_ctl_t el_ctl;
+// Allocator state is an el_ctl_t instance, an "arena". The el_*
+// functions act on the current arena which starts out as
+// el_default_ctl; el_arena_use() switches to another one made by
+// el_arena_create() and the el_arena_* functions run a single call in
+// a given arena. el_ctl names the current arena so code written for
+// the single global allocator works unchanged. The current arena is
+// per thread so threads may each work in arenas of their own; an
+// arena itself, el_default_ctl included, must only be used by one
+// thread at a time.
+extern el_ctl_t el_default_ctl;
+extern __thread el_ctl_t *el_current;
+#define el_ctl (*el_current)
 
 // functions in el_malloc.c
 int  el_init(int max_bytes);
+int  el_init_heap(void *heap, size_t max_bytes);
+int  el_init_file(const char *path, size_t max_bytes);
+void el_set_root(void *ptr);
+void *el_get_root();
+int  el_check_heap();
+void el_reset();
+void el_set_bump(int on);
+void el_set_mmap_threshold(size_t nbytes);
+
+el_ctl_t *el_arena_create(size_t max_bytes);
+void el_arena_destroy(el_ctl_t *arena);
+el_ctl_t *el_arena_use(el_ctl_t *arena);
+void *el_arena_malloc(el_ctl_t *arena, size_t nbytes);
+void el_arena_free(el_ctl_t *arena, void *ptr);
 void el_print_stats();
 void el_cleanup();
+void el_mark_touched(el_blockhead_t *block);
 
 el_blockfoot_t *el_get_footer(el_blockhead_t *block);
 el_blockhead_t *el_get_header(el_blockfoot_t *foot);
 el_blockhead_t *el_block_above(el_blockhead_t *block);
 el_blockhead_t *el_block_below(el_blockhead_t *block);
+void el_set_size(el_blockhead_t *block, size_t size);
+void el_set_state(el_blockhead_t *block, char state);
+void el_sync_footer(el_blockhead_t *block);
 
 void el_init_blocklist(el_blocklist_t *list);
 void el_print_blocklist(el_blocklist_t *list);
+void el_print_block(int i, el_blockhead_t *block);
 void el_add_block_front(el_blocklist_t *list, el_blockhead_t *block);
 void el_remove_block(el_blocklist_t *list, el_blockhead_t *block);
+void el_add_used(el_blockhead_t *block);
+void el_remove_used(el_blockhead_t *block);
+int  el_set_used_links(int on);
+void el_set_quick_limits(size_t max_size, size_t max_count);
+void el_flush_quick_lists();
 
+size_t el_request_size(size_t nbytes);
 el_blockhead_t *el_find_first_avail(size_t size);
 el_blockhead_t *el_split_block(el_blockhead_t *block, size_t new_size);
 el_blockhead_t *el_allocate_block(size_t size);
 void *el_malloc(size_t nbytes);
+void *el_calloc(size_t nmemb, size_t size);
+void *el_aligned_alloc(size_t alignment, size_t nbytes);
+void *el_realloc(void *ptr, size_t nbytes);
+size_t el_usable_size(void *ptr);
+size_t el_malloc_batch(size_t nbytes, size_t count, void **ptrs);
 
 void el_merge_block_with_above(el_blockhead_t *lower);
 void el_free(void *ptr);
+void el_free_batch(void **ptrs, size_t count);
+
+void el_count_request(size_t nbytes);
+void el_count_used();
+void el_count_search(size_t steps);
+void el_get_stats(el_stats_t *stats);
+double el_fragmentation(size_t *largest);
+void el_trace_start(el_trace_event_t *ring, size_t capacity, size_t sample_every);
+void el_trace_stop();
+size_t el_trace_count();
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
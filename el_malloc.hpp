@@ -0,0 +1,151 @@
+// el_malloc.hpp: C++ adaptors that bind standard containers to an
+// el_malloc arena.
+//
+//   el::arena arena(1 << 20);                   // heap of its own
+//   el::memory_resource resource(arena);
+//   std::pmr::vector<int> v(&resource);         // via std::pmr
+//   std::vector<int, el::allocator<int>> w{el::allocator<int>(arena)};
+//
+// An arena made with bump set ignores deallocation; reset() then
+// gives back everything at once, which suits per-request arenas. An
+// arena and everything allocated from it must not outlive it.
+// Payloads are only aligned in the compact block layout so this
+// header needs EL_COMPACT_HEADERS, as el_preload.c does.
+
+#ifndef EL_MALLOC_HPP
+#define EL_MALLOC_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <memory_resource>
+#include "el_malloc.h"
+
+#ifndef EL_COMPACT_HEADERS
+#error "el_malloc.hpp must be built with -DEL_COMPACT_HEADERS"
+#endif
+
+namespace el {
+
+// Owner of an arena from el_arena_create(). Allocation failures throw
+// std::bad_alloc.
+class arena {
+public:
+  explicit arena(std::size_t max_bytes, bool bump = false)
+    : ctl_(el_arena_create(max_bytes)) {
+    if(ctl_ == nullptr){
+      throw std::bad_alloc();
+    }
+    el_ctl_t *prev = el_arena_use(ctl_);
+    el_set_bump(bump);
+    el_arena_use(prev);
+  }
+  ~arena(){
+    el_arena_destroy(ctl_);
+  }
+  arena(const arena &) = delete;
+  arena &operator=(const arena &) = delete;
+
+  el_ctl_t *get() const {
+    return ctl_;
+  }
+
+  void *allocate(std::size_t nbytes, std::size_t alignment = alignof(std::max_align_t)){
+    void *ptr;
+    if(alignment > EL_ALIGN){
+      el_ctl_t *prev = el_arena_use(ctl_);
+      ptr = el_aligned_alloc(alignment, nbytes);
+      el_arena_use(prev);
+    }
+    else{
+      ptr = el_arena_malloc(ctl_, nbytes);
+    }
+    if(ptr == nullptr){
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+
+  void deallocate(void *ptr){
+    el_arena_free(ctl_, ptr);
+  }
+
+  // Drop every allocation at once, see el_reset().
+  void reset(){
+    el_ctl_t *prev = el_arena_use(ctl_);
+    el_reset();
+    el_arena_use(prev);
+  }
+
+private:
+  el_ctl_t *ctl_;
+};
+
+// std::pmr::memory_resource allocating from an arena. Two resources
+// compare equal when they share an arena.
+class memory_resource : public std::pmr::memory_resource {
+public:
+  explicit memory_resource(arena &a) noexcept : arena_(&a) {}
+
+  arena &get_arena() const noexcept {
+    return *arena_;
+  }
+
+private:
+  void *do_allocate(std::size_t nbytes, std::size_t alignment) override {
+    return arena_->allocate(nbytes, alignment);
+  }
+
+  void do_deallocate(void *ptr, std::size_t, std::size_t) override {
+    arena_->deallocate(ptr);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    const memory_resource *el = dynamic_cast<const memory_resource *>(&other);
+    return el != nullptr && el->arena_ == arena_;
+  }
+
+  arena *arena_;
+};
+
+// Standard allocator allocating from an arena, for containers that
+// take an allocator type rather than a memory_resource.
+template <class T>
+class allocator {
+public:
+  using value_type = T;
+
+  explicit allocator(arena &a) noexcept : arena_(&a) {}
+
+  template <class U>
+  allocator(const allocator<U> &other) noexcept : arena_(other.arena_) {}
+
+  T *allocate(std::size_t n){
+    if(n > SIZE_MAX / sizeof(T)){
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *ptr, std::size_t) noexcept {
+    arena_->deallocate(ptr);
+  }
+
+  template <class U>
+  bool operator==(const allocator<U> &other) const noexcept {
+    return arena_ == other.arena_;
+  }
+
+  template <class U>
+  bool operator!=(const allocator<U> &other) const noexcept {
+    return arena_ != other.arena_;
+  }
+
+private:
+  template <class U> friend class allocator;
+  arena *arena_;
+};
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+// el_pmr_demo.cpp: standard containers allocating from el_malloc
+// arenas through el_malloc.hpp.
+//
+// Simulates a server handling requests that each build a word list
+// and a word count table, then throws them away. The same work is
+// run with the default allocator (operator new/delete), with one
+// el_malloc arena per request freeing as it goes, with a bump arena
+// that is reset after each request, and with
+// std::pmr::monotonic_buffer_resource for reference. Results must
+// agree; the time per request is printed for each.
+//
+// usage: el_pmr_demo [requests]
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "el_malloc.hpp"
+
+#define ARENA_BYTES (4 << 20)
+#define WORDS 4000
+
+// One request: split the text into words, count them and return a
+// checksum of the distinct words and the highest count.
+static unsigned long handle_request(const std::string &text,
+                                    std::pmr::memory_resource *resource){
+  std::pmr::vector<std::pmr::string> words(resource);
+  std::pmr::string word(resource);
+  for(char c : text){
+    if(c == ' '){
+      words.push_back(word);
+      word.clear();
+    }
+    else{
+      word.push_back(c);
+    }
+  }
+  std::pmr::unordered_map<std::pmr::string, int> counts(resource);
+  for(const std::pmr::string &w : words){
+    counts[w]++;
+  }
+  unsigned long sum = counts.size();
+  int most = 0;
+  for(const auto &kv : counts){
+    most = kv.second > most ? kv.second : most;
+  }
+  return sum * 1000 + most;
+}
+
+// Text of WORDS words, long enough that most strings allocate.
+static std::string make_text(unsigned seed){
+  std::string text;
+  srand(seed);
+  for(int i=0; i<WORDS; i++){
+    int len = 10 + rand() % 30;
+    char first = 'a' + rand() % 4;
+    text += std::string(len, first);
+    text += ' ';
+  }
+  return text;
+}
+
+template <class F>
+static double time_requests(const char *name, int nreq,
+                            const std::vector<std::string> &texts,
+                            std::vector<unsigned long> &results, F run){
+  auto start = std::chrono::steady_clock::now();
+  for(int i=0; i<nreq; i++){
+    results[i] = run(texts[i % texts.size()]);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() / nreq;
+  printf("%-22s %10.0f ns/request\n", name, ns);
+  return ns;
+}
+
+int main(int argc, char *argv[]){
+  int nreq = argc > 1 ? atoi(argv[1]) : 2000;
+  std::vector<std::string> texts;
+  for(unsigned s=1; s<=8; s++){
+    texts.push_back(make_text(s));
+  }
+
+  std::vector<unsigned long> expect(nreq), got(nreq);
+  int failed = 0;
+  auto check = [&](const char *name){
+    if(got != expect){
+      printf("MISMATCH: %s\n", name);
+      failed = 1;
+    }
+  };
+
+  time_requests("new/delete", nreq, texts, expect, [](const std::string &text){
+    return handle_request(text, std::pmr::new_delete_resource());
+  });
+
+  time_requests("el arena per request", nreq, texts, got, [](const std::string &text){
+    el::arena arena(ARENA_BYTES);
+    el::memory_resource resource(arena);
+    return handle_request(text, &resource);
+  });
+  check("el arena per request");
+
+  el::arena bump(ARENA_BYTES, true);
+  el::memory_resource bump_resource(bump);
+  time_requests("el bump arena + reset", nreq, texts, got, [&](const std::string &text){
+    unsigned long result = handle_request(text, &bump_resource);
+    bump.reset();
+    return result;
+  });
+  check("el bump arena + reset");
+
+  std::vector<char> buffer(ARENA_BYTES);
+  time_requests("pmr monotonic buffer", nreq, texts, got, [&](const std::string &text){
+    std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+    return handle_request(text, &resource);
+  });
+  check("pmr monotonic buffer");
+
+  // el::allocator for containers without a pmr alias
+  el::arena arena(ARENA_BYTES);
+  {
+    typedef std::pair<const int, int> entry_t;
+    std::map<int, int, std::less<int>, el::allocator<entry_t>> squares{el::allocator<entry_t>(arena)};
+    for(int i=0; i<1000; i++){
+      squares[i] = i*i;
+    }
+    std::vector<int, el::allocator<int>> copy{el::allocator<int>(arena)};
+    for(const auto &kv : squares){
+      copy.push_back(kv.second);
+    }
+    if(copy.size() != 1000 || copy[999] != 999*999){
+      printf("MISMATCH: el::allocator\n");
+      failed = 1;
+    }
+  }
+
+  // over-aligned elements come from el_aligned_alloc()
+  {
+    struct alignas(64) lane_t { float v[16]; };
+    el::memory_resource resource(arena);
+    std::pmr::vector<lane_t> lanes(100, lane_t{}, &resource);
+    if((reinterpret_cast<std::uintptr_t>(lanes.data()) & 63) != 0){
+      printf("MISMATCH: alignas(64) vector\n");
+      failed = 1;
+    }
+  }
+
+  // everything went back to the arena
+  el_ctl_t *prev = el_arena_use(arena.get());
+  if(el_ctl.used->length != 0 || el_ctl.avail->length != 1){
+    printf("MISMATCH: arena not empty\n");
+    failed = 1;
+  }
+  el_arena_use(prev);
+
+  printf("%s\n", failed ? "FAIL" : "OK");
+  return failed;
+}
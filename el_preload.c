@@ -0,0 +1,220 @@
+// el_preload.c: LD_PRELOAD shim making el_malloc the allocator of an
+// unmodified program.
+//
+// Build libel_malloc.so with 'make libel_malloc.so' and run
+//
+//   LD_PRELOAD=./libel_malloc.so program args...
+//
+// The shim interposes malloc(), free(), calloc(), realloc(),
+// posix_memalign(), aligned_alloc() and malloc_usable_size(). The heap
+// is a single mmap()'d region set up on the first call; its size in
+// megabytes comes from the EL_PRELOAD_HEAP_MB environment variable
+// (default 1024). Pages are only backed as they are touched.
+//
+// Memory not from el_malloc ("foreign" pointers) is handed to glibc:
+// blocks allocated before or during setup, from re-entrant calls and
+// once the heap is exhausted. The
+// free/realloc/size functions tell the two apart by whether the
+// pointer lies inside the heap, so el_malloc's own mapping of huge
+// blocks is turned off. el_malloc is not thread safe so every
+// call is made under one mutex.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "el_malloc.h"
+
+// programs expect malloc() to return aligned memory which only the
+// compact layout guarantees
+#ifndef EL_COMPACT_HEADERS
+#error "el_preload.c must be built with -DEL_COMPACT_HEADERS"
+#endif
+
+#define EL_PRELOAD_DEFAULT_MB 1024
+
+// glibc's own allocator entry points, used for foreign pointers
+void *__libc_malloc(size_t nbytes);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t nbytes);
+void *__libc_memalign(size_t alignment, size_t nbytes);
+void  __libc_free(void *ptr);
+
+static pthread_mutex_t el_lock = PTHREAD_MUTEX_INITIALIZER;
+static int el_ready = 0;        // 1 once the heap is set up, -1 if setup failed
+
+// Set while this thread is inside the allocator so re-entrant calls,
+// e.g. from dlsym(), go to glibc instead of deadlocking. The
+// initial-exec model keeps TLS access from calling malloc() itself.
+static __thread int el_busy __attribute__((tls_model("initial-exec")));
+
+// Take the lock and set up the heap on first use. Returns 1 if the
+// caller may use el_malloc, otherwise 0 with the lock not held.
+static int el_enter(){
+  if(el_busy || el_ready < 0){
+    return 0;
+  }
+  el_busy = 1;
+  pthread_mutex_lock(&el_lock);
+  if(el_ready == 0){
+    size_t mb = EL_PRELOAD_DEFAULT_MB;
+    char *env = getenv("EL_PRELOAD_HEAP_MB");
+    if(env != NULL && atol(env) > 0){
+      mb = atol(env);
+    }
+    size_t bytes = mb << 20;
+    void *heap = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(heap == MAP_FAILED || el_init_heap(heap, bytes) != 0){
+      el_ready = -1;
+      pthread_mutex_unlock(&el_lock);
+      el_busy = 0;
+      return 0;
+    }
+    // blocks mapped outside the heap would look foreign to el_owns()
+    el_set_mmap_threshold(0);
+    el_ready = 1;
+  }
+  return 1;
+}
+
+static void el_leave(){
+  pthread_mutex_unlock(&el_lock);
+  el_busy = 0;
+}
+
+// Whether ptr was handed out by el_malloc. Only meaningful once the
+// heap is set up; before that every pointer is foreign.
+static int el_owns(void *ptr){
+  return el_ready > 0 && ptr >= el_ctl.heap_start && ptr < el_ctl.heap_end;
+}
+
+// Keep the lock consistent across fork(): the child gets a copy of
+// the heap and must not inherit a lock held by another thread.
+static void el_fork_prepare(){
+  pthread_mutex_lock(&el_lock);
+}
+
+static void el_fork_release(){
+  pthread_mutex_unlock(&el_lock);
+}
+
+__attribute__((constructor))
+static void el_preload_setup(){
+  pthread_atfork(el_fork_prepare, el_fork_release, el_fork_release);
+}
+
+void *malloc(size_t nbytes){
+  if(!el_enter()){
+    return __libc_malloc(nbytes);
+  }
+  void *ptr = el_malloc(nbytes);
+  el_leave();
+  return ptr != NULL ? ptr : __libc_malloc(nbytes);
+}
+
+void free(void *ptr){
+  if(ptr == NULL){
+    return;
+  }
+  if(!el_owns(ptr)){
+    __libc_free(ptr);
+    return;
+  }
+  // el_owns() implies the heap is set up so el_enter() only fails
+  // for a re-entrant call which cannot be freeing el_malloc memory
+  if(el_enter()){
+    el_free(ptr);
+    el_leave();
+  }
+}
+
+void *calloc(size_t nmemb, size_t size){
+  if(!el_enter()){
+    return __libc_calloc(nmemb, size);
+  }
+  void *ptr = el_calloc(nmemb, size);
+  el_leave();
+  return ptr != NULL ? ptr : __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t nbytes){
+  if(ptr == NULL){
+    return malloc(nbytes);
+  }
+  if(!el_owns(ptr)){
+    return __libc_realloc(ptr, nbytes);
+  }
+  if(nbytes == 0){
+    free(ptr);
+    return NULL;
+  }
+  if(!el_enter()){
+    return NULL;
+  }
+  void *newPtr = el_realloc(ptr, nbytes);
+  size_t oldSize = el_usable_size(ptr);
+  el_leave();
+  if(newPtr != NULL){
+    return newPtr;
+  }
+  // heap exhausted: move the block over to glibc
+  newPtr = __libc_malloc(nbytes);
+  if(newPtr != NULL){
+    memcpy(newPtr, ptr, oldSize < nbytes ? oldSize : nbytes);
+    free(ptr);
+  }
+  return newPtr;
+}
+
+// Allocate with the given power of two alignment.
+static void *el_preload_memalign(size_t alignment, size_t nbytes){
+  if(!el_enter()){
+    return __libc_memalign(alignment, nbytes);
+  }
+  void *ptr = el_aligned_alloc(alignment, nbytes);
+  el_leave();
+  return ptr != NULL ? ptr : __libc_memalign(alignment, nbytes);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t nbytes){
+  if(alignment < sizeof(void *) || (alignment & (alignment-1)) != 0){
+    return EINVAL;
+  }
+  void *ptr = el_preload_memalign(alignment, nbytes);
+  if(ptr == NULL){
+    return ENOMEM;
+  }
+  *memptr = ptr;
+  return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t nbytes){
+  if(alignment == 0 || (alignment & (alignment-1)) != 0){
+    errno = EINVAL;
+    return NULL;
+  }
+  return el_preload_memalign(alignment, nbytes);
+}
+
+size_t malloc_usable_size(void *ptr){
+  if(ptr == NULL){
+    return 0;
+  }
+  if(el_owns(ptr)){
+    return el_usable_size(ptr);
+  }
+  // glibc has no __libc_ name for this one; dlsym() may allocate but
+  // those calls go to glibc via el_busy
+  static size_t (*libc_usable_size)(void *) = NULL;
+  if(libc_usable_size == NULL){
+    el_busy++;
+    libc_usable_size = (size_t (*)(void *)) dlsym(RTLD_NEXT, "malloc_usable_size");
+    el_busy--;
+  }
+  return libc_usable_size(ptr);
+}
@@ -72,7 +72,7 @@ if [ "$run_norm" = "1" ]; then
         printf "%s " "$c_file"
         printf "%s\n%s\n%s\n" "${defines[i]}" "${TEMPLATE}" "${cfile[i]}" > $c_file
         printf "Compiling "
-        gcc -g -o $prog_file $c_file el_malloc.o -I .
+        gcc -g -o $prog_file $c_file ${objects[i]:-el_malloc.o} -I .
 
         printf "Running : "
         $prog_file >& $ACTUAL
@@ -119,7 +119,7 @@ if [ "$run_valg" = "1" ]; then
         printf "%s " "$c_file"
         printf "%s\n%s\n%s\n" "${defines[i]}" "${TEMPLATE}" "${cfile[i]}" > $c_file
         printf "Compiling "
-        gcc -g -o $prog_file $c_file el_malloc.o -I .
+        gcc -g -o $prog_file $c_file ${objects[i]:-el_malloc.o} -I .
 
         printf "Running : "
         # run code through valgrind
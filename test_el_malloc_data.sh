@@ -1,5 +1,7 @@
 #!/bin/bash
 T=0                             # global test number
+# objects[T] may name the allocator object a test links against; the
+# default is el_malloc.o
 
 # Global template to start a test
 read  -r -d '' TEMPLATE <<EOF
@@ -1146,3 +1148,1437 @@ ptr[ 9]: (nil)
 ptr[10]: 272 from heap start
 ptr[11]: 944 from heap start
 ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="realloc_inplace"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_malloc(100);
+  ptr[len++] = el_malloc(64);
+  strcpy(ptr[1], "hello realloc");
+  printf("\nMALLOC 0-2\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  ptr[1] = el_realloc(ptr[1], 40);
+  printf("\nSHRINK 1\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  printf("%s\n", (char *) ptr[1]);
+
+  ptr[1] = el_realloc(ptr[1], 90);
+  printf("\nGROW 1 ABOVE\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  printf("%s\n", (char *) ptr[1]);
+
+  el_free(ptr[0]); ptr[0] = NULL;
+  ptr[1] = el_realloc(ptr[1], 150);
+  printf("\nGROW 1 BELOW\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  printf("%s\n", (char *) ptr[1]);
+
+  ptr[1] = el_realloc(ptr[1], 400);
+  printf("\nGROW 1 MOVE\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  printf("%s\n", (char *) ptr[1]);
+
+  ptr[3] = el_realloc(ptr[1], 2048);
+  printf("\nGROW 1 FAIL\n");
+  print_ptr_offset("ptr[ 3]",ptr[3]);
+  printf("%s\n", (char *) ptr[1]);
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC 0-2
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    676}
+  [  0] head @    348 {state: a  size:    636}  foot @   1016 {size:    636}
+USED LIST: blocklist{length:      3  bytes:    348}
+  [  0] head @    244 {state: u  size:     64}  foot @    340 {size:     64}
+  [  1] head @    104 {state: u  size:    100}  foot @    236 {size:    100}
+  [  2] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 136 from heap start
+ptr[ 2]: 276 from heap start
+
+SHRINK 1
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    736}
+  [  0] head @    184 {state: a  size:     20}  foot @    236 {size:     20}
+  [  1] head @    348 {state: a  size:    636}  foot @   1016 {size:    636}
+USED LIST: blocklist{length:      3  bytes:    288}
+  [  0] head @    104 {state: u  size:     40}  foot @    176 {size:     40}
+  [  1] head @    244 {state: u  size:     64}  foot @    340 {size:     64}
+  [  2] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 136 from heap start
+ptr[ 2]: 276 from heap start
+hello realloc
+
+GROW 1 ABOVE
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    676}
+  [  0] head @    348 {state: a  size:    636}  foot @   1016 {size:    636}
+USED LIST: blocklist{length:      3  bytes:    348}
+  [  0] head @    104 {state: u  size:    100}  foot @    236 {size:    100}
+  [  1] head @    244 {state: u  size:     64}  foot @    340 {size:     64}
+  [  2] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 136 from heap start
+ptr[ 2]: 276 from heap start
+hello realloc
+
+GROW 1 BELOW
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    730}
+  [  0] head @    190 {state: a  size:     14}  foot @    236 {size:     14}
+  [  1] head @    348 {state: a  size:    636}  foot @   1016 {size:    636}
+USED LIST: blocklist{length:      2  bytes:    294}
+  [  0] head @      0 {state: u  size:    150}  foot @    182 {size:    150}
+  [  1] head @    244 {state: u  size:     64}  foot @    340 {size:     64}
+
+POINTERS
+ptr[ 0]: (nil)
+ptr[ 1]: 32 from heap start
+ptr[ 2]: 276 from heap start
+hello realloc
+
+GROW 1 MOVE
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    480}
+  [  0] head @      0 {state: a  size:    204}  foot @    236 {size:    204}
+  [  1] head @    788 {state: a  size:    196}  foot @   1016 {size:    196}
+USED LIST: blocklist{length:      2  bytes:    544}
+  [  0] head @    348 {state: u  size:    400}  foot @    780 {size:    400}
+  [  1] head @    244 {state: u  size:     64}  foot @    340 {size:     64}
+
+POINTERS
+ptr[ 0]: (nil)
+ptr[ 1]: 380 from heap start
+ptr[ 2]: 276 from heap start
+hello realloc
+
+GROW 1 FAIL
+ptr[ 3]: (nil)
+hello realloc
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="calloc_zeroed"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+int all_zero(char *p, size_t n){
+  for(size_t i=0; i<n; i++){
+    if(p[i] != 0){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  ptr[len++] = el_calloc(16, 8);
+  printf("zeroed: %d\n", all_zero(ptr[0],128));
+  memset(ptr[0], 'x', 128);
+  ptr[len++] = el_calloc(10, 10);
+  printf("zeroed: %d\n", all_zero(ptr[1],100));
+  printf("\nCALLOC 0-1\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  el_free(ptr[0]);
+  ptr[0] = el_calloc(4, 20);
+  printf("\nFREE 0, CALLOC 0\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  printf("zeroed: %d\n", all_zero(ptr[0],80));
+
+  ptr[len++] = el_calloc(((size_t) -1) / 2, 4);
+  printf("\nCALLOC OVERFLOW\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+zeroed: 1
+zeroed: 1
+
+CALLOC 0-1
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    716}
+  [  0] head @    308 {state: a  size:    676}  foot @   1016 {size:    676}
+USED LIST: blocklist{length:      2  bytes:    308}
+  [  0] head @    168 {state: u  size:    100}  foot @    300 {size:    100}
+  [  1] head @      0 {state: u  size:    128}  foot @    160 {size:    128}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 200 from heap start
+
+FREE 0, CALLOC 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    764}
+  [  0] head @    120 {state: a  size:      8}  foot @    160 {size:      8}
+  [  1] head @    308 {state: a  size:    676}  foot @   1016 {size:    676}
+USED LIST: blocklist{length:      2  bytes:    260}
+  [  0] head @      0 {state: u  size:     80}  foot @    112 {size:     80}
+  [  1] head @    168 {state: u  size:    100}  foot @    300 {size:    100}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 200 from heap start
+zeroed: 1
+
+CALLOC OVERFLOW
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 200 from heap start
+ptr[ 2]: (nil)
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="compact_layout"
+objects[T]="el_malloc_compact.o"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+#define EL_COMPACT_HEADERS
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  printf("EL_BLOCK_OVERHEAD: %lu\n", EL_BLOCK_OVERHEAD);
+  ptr[len++] = el_malloc(128);
+  ptr[len++] = el_malloc(1);
+  ptr[len++] = el_malloc(100);
+  ptr[len++] = el_malloc(24);
+  printf("\nMALLOC 0-3\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  for(int i=0; i<len; i++){
+    printf("ptr[%2d] aligned: %d\n", i, ((size_t) ptr[i]) % 16 == 0);
+  }
+
+  el_free(ptr[1]); ptr[1] = NULL;
+  printf("\nFREE 1\n"); el_print_stats(); printf("\n");
+
+  el_free(ptr[0]); ptr[0] = NULL;
+  printf("\nFREE 0\n"); el_print_stats(); printf("\n");
+
+  el_free(ptr[3]); ptr[3] = NULL;
+  printf("\nFREE 3\n"); el_print_stats(); printf("\n");
+
+  el_free(ptr[2]); ptr[2] = NULL;
+  printf("\nFREE 2\n"); el_print_stats(); printf("\n");
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+EL_BLOCK_OVERHEAD: 8
+
+MALLOC 0-3
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    688}
+  [  0] head @    328 {state: a  size:    680}  foot @   1008 {size:    680}
+USED LIST: blocklist{length:      4  bytes:    320}
+  [  0] head @      8 {state: u  size:    136}
+  [  1] head @    152 {state: u  size:     24}
+  [  2] head @    184 {state: u  size:    104}
+  [  3] head @    296 {state: u  size:     24}
+
+POINTERS
+ptr[ 0]: 16 from heap start
+ptr[ 1]: 160 from heap start
+ptr[ 2]: 192 from heap start
+ptr[ 3]: 304 from heap start
+ptr[ 0] aligned: 1
+ptr[ 1] aligned: 1
+ptr[ 2] aligned: 1
+ptr[ 3] aligned: 1
+
+FREE 1
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    720}
+  [  0] head @    152 {state: a  size:     24}  foot @    176 {size:     24}
+  [  1] head @    328 {state: a  size:    680}  foot @   1008 {size:    680}
+USED LIST: blocklist{length:      3  bytes:    288}
+  [  0] head @      8 {state: u  size:    136}
+  [  1] head @    184 {state: u  size:    104}
+  [  2] head @    296 {state: u  size:     24}
+
+
+FREE 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    864}
+  [  0] head @      8 {state: a  size:    168}  foot @    176 {size:    168}
+  [  1] head @    328 {state: a  size:    680}  foot @   1008 {size:    680}
+USED LIST: blocklist{length:      2  bytes:    144}
+  [  0] head @    184 {state: u  size:    104}
+  [  1] head @    296 {state: u  size:     24}
+
+
+FREE 3
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    896}
+  [  0] head @    296 {state: a  size:    712}  foot @   1008 {size:    712}
+  [  1] head @      8 {state: a  size:    168}  foot @    176 {size:    168}
+USED LIST: blocklist{length:      1  bytes:    112}
+  [  0] head @    184 {state: u  size:    104}
+
+
+FREE 2
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1008}
+  [  0] head @      8 {state: a  size:   1000}  foot @   1008 {size:   1000}
+USED LIST: blocklist{length:      0  bytes:      0}
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="compact_realloc"
+objects[T]="el_malloc_compact.o"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+#define EL_COMPACT_HEADERS
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_calloc(20, 5);
+  ptr[len++] = el_malloc(64);
+  strcpy(ptr[1], "compact realloc");
+  printf("\nMALLOC 0-2\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  ptr[1] = el_realloc(ptr[1], 40);
+  printf("\nSHRINK 1\n"); el_print_stats(); printf("\n");
+  printf("%s\n", (char *) ptr[1]);
+
+  el_free(ptr[0]); ptr[0] = NULL;
+  ptr[1] = el_realloc(ptr[1], 150);
+  printf("\nGROW 1 BELOW\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  printf("%s\n", (char *) ptr[1]);
+
+  el_free(ptr[1]); ptr[1] = NULL;
+  el_free(ptr[2]); ptr[2] = NULL;
+  printf("\nFREE 1,2\n"); el_print_stats(); printf("\n");
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC 0-2
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    736}
+  [  0] head @    280 {state: a  size:    728}  foot @   1008 {size:    728}
+USED LIST: blocklist{length:      3  bytes:    272}
+  [  0] head @      8 {state: u  size:     72}
+  [  1] head @     88 {state: u  size:    104}
+  [  2] head @    200 {state: u  size:     72}
+
+POINTERS
+ptr[ 0]: 16 from heap start
+ptr[ 1]: 96 from heap start
+ptr[ 2]: 208 from heap start
+
+SHRINK 1
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    800}
+  [  0] head @    136 {state: a  size:     56}  foot @    192 {size:     56}
+  [  1] head @    280 {state: a  size:    728}  foot @   1008 {size:    728}
+USED LIST: blocklist{length:      3  bytes:    208}
+  [  0] head @      8 {state: u  size:     72}
+  [  1] head @     88 {state: u  size:     40}
+  [  2] head @    200 {state: u  size:     72}
+
+compact realloc
+
+GROW 1 BELOW
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    768}
+  [  0] head @    168 {state: a  size:     24}  foot @    192 {size:     24}
+  [  1] head @    280 {state: a  size:    728}  foot @   1008 {size:    728}
+USED LIST: blocklist{length:      2  bytes:    240}
+  [  0] head @      8 {state: u  size:    152}
+  [  1] head @    200 {state: u  size:     72}
+
+POINTERS
+ptr[ 0]: (nil)
+ptr[ 1]: 16 from heap start
+ptr[ 2]: 208 from heap start
+compact realloc
+
+FREE 1,2
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1008}
+  [  0] head @      8 {state: a  size:   1000}  foot @   1008 {size:   1000}
+USED LIST: blocklist{length:      0  bytes:      0}
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="unlinked_used"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  el_set_used_links(0);
+  ptr[len++] = el_malloc(128);
+  ptr[len++] = el_malloc(200);
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_malloc(32);
+  printf("\nMALLOC 0-3\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  el_free(ptr[1]); ptr[1] = NULL;
+  el_free(ptr[3]); ptr[3] = NULL;
+  printf("\nFREE 1,3\n"); el_print_stats(); printf("\n");
+
+  el_set_used_links(1);
+  ptr[1] = el_malloc(100);
+  printf("\nLINKED, MALLOC 1\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC 0-3
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    440}
+  [  0] head @    584 {state: a  size:    400}  foot @   1016 {size:    400}
+USED LIST: blocklist{length:      4  bytes:    584}
+  [  0] head @      0 {state: u  size:    128}  foot @    160 {size:    128}
+  [  1] head @    168 {state: u  size:    200}  foot @    400 {size:    200}
+  [  2] head @    408 {state: u  size:     64}  foot @    504 {size:     64}
+  [  3] head @    512 {state: u  size:     32}  foot @    576 {size:     32}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 200 from heap start
+ptr[ 2]: 440 from heap start
+ptr[ 3]: 544 from heap start
+
+FREE 1,3
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    752}
+  [  0] head @    512 {state: a  size:    472}  foot @   1016 {size:    472}
+  [  1] head @    168 {state: a  size:    200}  foot @    400 {size:    200}
+USED LIST: blocklist{length:      2  bytes:    272}
+  [  0] head @      0 {state: u  size:    128}  foot @    160 {size:    128}
+  [  1] head @    408 {state: u  size:     64}  foot @    504 {size:     64}
+
+
+LINKED, MALLOC 1
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    612}
+  [  0] head @    652 {state: a  size:    332}  foot @   1016 {size:    332}
+  [  1] head @    168 {state: a  size:    200}  foot @    400 {size:    200}
+USED LIST: blocklist{length:      3  bytes:    412}
+  [  0] head @    512 {state: u  size:    100}  foot @    644 {size:    100}
+  [  1] head @    408 {state: u  size:     64}  foot @    504 {size:     64}
+  [  2] head @      0 {state: u  size:    128}  foot @    160 {size:    128}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 544 from heap start
+ptr[ 2]: 440 from heap start
+ptr[ 3]: (nil)
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="stats_trace"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void print_counters(){
+  el_stats_t st;
+  el_get_stats(&st);
+  printf("allocs: %lu  frees: %lu  reallocs: %lu  failed: %lu\n",
+         st.allocs, st.frees, st.reallocs, st.failed);
+  printf("splits: %lu  merges: %lu  searches: %lu  steps: %lu  max steps: %lu\n",
+         st.splits, st.merges, st.searches, st.search_steps, st.max_search_steps);
+  printf("used: %lu/%lu  avail: %lu/%lu  peak: %lu\n",
+         st.used_blocks, st.used_bytes, st.avail_blocks, st.avail_bytes, st.peak_bytes);
+  for(int i=0; i<EL_HIST_BUCKETS; i++){
+    if(st.hist[i] != 0){
+      printf("hist[%2d]: %lu\n", i, st.hist[i]);
+    }
+  }
+  size_t largest;
+  double frag = el_fragmentation(&largest);
+  printf("largest free: %lu  fragmentation: %.3f\n", largest, frag);
+}
+
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+  el_trace_event_t ring[4];
+  el_trace_start(ring, 4, 2);
+
+  ptr[len++] = el_malloc(128);
+  ptr[len++] = el_malloc(200);
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_malloc(32);
+  ptr[len++] = el_malloc(2000);
+  printf("\nMALLOC 0-4\n"); print_counters();
+
+  el_free(ptr[0]); ptr[0] = NULL;
+  el_free(ptr[2]); ptr[2] = NULL;
+  printf("\nFREE 0,2\n"); print_counters();
+
+  ptr[1] = el_realloc(ptr[1], 260);
+  el_free(ptr[3]); ptr[3] = NULL;
+  printf("\nREALLOC 1, FREE 3\n"); print_counters();
+
+  el_trace_stop();
+  size_t count = el_trace_count();
+  printf("\nTRACE %lu events\n", count);
+  for(size_t i = count > 4 ? count-4 : 0; i<count; i++){
+    el_trace_event_t *ev = &ring[i % 4];
+    if(ev->offset == EL_TRACE_NO_OFFSET){
+      printf("%c %4lu  offset: (nil)  steps: %lu\n", ev->op, ev->nbytes, ev->steps);
+    }
+    else{
+      printf("%c %4lu  offset: %4lu  steps: %lu\n", ev->op, ev->nbytes, ev->offset, ev->steps);
+    }
+  }
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC 0-4
+allocs: 4  frees: 0  reallocs: 0  failed: 1
+splits: 4  merges: 0  searches: 4  steps: 4  max steps: 1
+used: 4/584  avail: 1/440  peak: 584
+hist[ 5]: 1
+hist[ 6]: 1
+hist[ 7]: 2
+hist[10]: 1
+largest free: 400  fragmentation: 0.000
+
+FREE 0,2
+allocs: 4  frees: 2  reallocs: 0  failed: 1
+splits: 4  merges: 0  searches: 4  steps: 4  max steps: 1
+used: 2/312  avail: 3/712  peak: 584
+hist[ 5]: 1
+hist[ 6]: 1
+hist[ 7]: 2
+hist[10]: 1
+largest free: 400  fragmentation: 0.324
+
+REALLOC 1, FREE 3
+allocs: 4  frees: 3  reallocs: 1  failed: 1
+splits: 5  merges: 3  searches: 4  steps: 4  max steps: 1
+used: 1/300  avail: 2/724  peak: 584
+hist[ 5]: 1
+hist[ 6]: 1
+hist[ 7]: 2
+hist[10]: 1
+largest free: 516  fragmentation: 0.199
+
+TRACE 5 events
+m   64  offset:  440  steps: 1
+m 2000  offset: (nil)  steps: 0
+f    0  offset:  440  steps: 0
+f    0  offset:  544  steps: 0
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="batch_alloc_free"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  void *batch[16] = {};
+  int len = 0;
+
+  ptr[len++] = el_malloc(100);
+  ptr[len++] = el_malloc(40);
+  ptr[len++] = el_malloc(300);
+  el_free(ptr[1]); ptr[1] = NULL;
+  printf("\nMALLOC 0-2, FREE 1\n"); el_print_stats(); printf("\n");
+
+  size_t got = el_malloc_batch(48, 5, batch);
+  printf("\nMALLOC BATCH 5 x 48: got %lu\n", got); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(batch, 5);
+
+  void *some[4] = {batch[3], NULL, batch[1], batch[2]};
+  el_free_batch(some, 4);
+  printf("\nFREE BATCH 3,1,2\n"); el_print_stats(); printf("\n");
+
+  got = el_malloc_batch(60, 3, batch+5);
+  printf("\nMALLOC BATCH 3 x 60: got %lu\n", got); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(batch+5, 3);
+
+  void *rest[6] = {batch[4], ptr[0], batch[6], batch[0], ptr[2], batch[5]};
+  el_free_batch(rest, 6);
+  printf("\nFREE BATCH REST\n"); el_print_stats(); printf("\n");
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC 0-2, FREE 1
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    544}
+  [  0] head @    140 {state: a  size:     40}  foot @    212 {size:     40}
+  [  1] head @    560 {state: a  size:    424}  foot @   1016 {size:    424}
+USED LIST: blocklist{length:      2  bytes:    480}
+  [  0] head @    220 {state: u  size:    300}  foot @    552 {size:    300}
+  [  1] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+
+
+MALLOC BATCH 5 x 48: got 5
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:     80}
+  [  0] head @    140 {state: a  size:     40}  foot @    212 {size:     40}
+USED LIST: blocklist{length:      7  bytes:    944}
+  [  0] head @    912 {state: u  size:     72}  foot @   1016 {size:     72}
+  [  1] head @    824 {state: u  size:     48}  foot @    904 {size:     48}
+  [  2] head @    736 {state: u  size:     48}  foot @    816 {size:     48}
+  [  3] head @    648 {state: u  size:     48}  foot @    728 {size:     48}
+  [  4] head @    560 {state: u  size:     48}  foot @    640 {size:     48}
+  [  5] head @    220 {state: u  size:    300}  foot @    552 {size:    300}
+  [  6] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+
+POINTERS
+ptr[ 0]: 592 from heap start
+ptr[ 1]: 680 from heap start
+ptr[ 2]: 768 from heap start
+ptr[ 3]: 856 from heap start
+ptr[ 4]: 944 from heap start
+
+FREE BATCH 3,1,2
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    344}
+  [  0] head @    648 {state: a  size:    224}  foot @    904 {size:    224}
+  [  1] head @    140 {state: a  size:     40}  foot @    212 {size:     40}
+USED LIST: blocklist{length:      4  bytes:    680}
+  [  0] head @    912 {state: u  size:     72}  foot @   1016 {size:     72}
+  [  1] head @    560 {state: u  size:     48}  foot @    640 {size:     48}
+  [  2] head @    220 {state: u  size:    300}  foot @    552 {size:    300}
+  [  3] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+
+
+MALLOC BATCH 3 x 60: got 2
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    144}
+  [  0] head @    848 {state: a  size:     24}  foot @    904 {size:     24}
+  [  1] head @    140 {state: a  size:     40}  foot @    212 {size:     40}
+USED LIST: blocklist{length:      6  bytes:    880}
+  [  0] head @    748 {state: u  size:     60}  foot @    840 {size:     60}
+  [  1] head @    648 {state: u  size:     60}  foot @    740 {size:     60}
+  [  2] head @    912 {state: u  size:     72}  foot @   1016 {size:     72}
+  [  3] head @    560 {state: u  size:     48}  foot @    640 {size:     48}
+  [  4] head @    220 {state: u  size:    300}  foot @    552 {size:    300}
+  [  5] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+
+POINTERS
+ptr[ 0]: 680 from heap start
+ptr[ 1]: 780 from heap start
+ptr[ 2]: (nil)
+
+FREE BATCH REST
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1024}
+  [  0] head @      0 {state: a  size:    984}  foot @   1016 {size:    984}
+USED LIST: blocklist{length:      0  bytes:      0}
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="quick_lists"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+  el_stats_t stats;
+
+  el_set_quick_limits(64, 2);
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_malloc(64);
+  ptr[len++] = el_malloc(200);
+  ptr[len++] = el_malloc(64);
+  printf("\nMALLOC 0-4\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  el_free(ptr[1]); ptr[1] = NULL;
+  el_free(ptr[2]); ptr[2] = NULL;
+  el_free(ptr[3]); ptr[3] = NULL;
+  printf("\nFREE 1-3\n"); el_print_stats(); printf("\n");
+
+  ptr[1] = el_malloc(64);
+  printf("\nMALLOC 1 FROM QUICK LIST\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  el_free(ptr[0]); ptr[0] = NULL;
+  el_free(ptr[4]); ptr[4] = NULL;
+  printf("\nFREE 0,4 OVERFLOWS\n"); el_print_stats(); printf("\n");
+
+  el_flush_quick_lists();
+  printf("\nFLUSH\n"); el_print_stats(); printf("\n");
+
+  el_get_stats(&stats);
+  printf("splits: %lu  merges: %lu  quick hits: %lu  quick flushes: %lu\n",
+         stats.splits, stats.merges, stats.quick_hits, stats.quick_flushes);
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC 0-4
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    368}
+  [  0] head @    656 {state: a  size:    328}  foot @   1016 {size:    328}
+USED LIST: blocklist{length:      5  bytes:    656}
+  [  0] head @    552 {state: u  size:     64}  foot @    648 {size:     64}
+  [  1] head @    312 {state: u  size:    200}  foot @    544 {size:    200}
+  [  2] head @    208 {state: u  size:     64}  foot @    304 {size:     64}
+  [  3] head @    104 {state: u  size:     64}  foot @    200 {size:     64}
+  [  4] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+QUICK LISTS: length:      0  bytes:      0
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 136 from heap start
+ptr[ 2]: 240 from heap start
+ptr[ 3]: 344 from heap start
+ptr[ 4]: 584 from heap start
+
+FREE 1-3
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    608}
+  [  0] head @    312 {state: a  size:    200}  foot @    544 {size:    200}
+  [  1] head @    656 {state: a  size:    328}  foot @   1016 {size:    328}
+USED LIST: blocklist{length:      2  bytes:    208}
+  [  0] head @    552 {state: u  size:     64}  foot @    648 {size:     64}
+  [  1] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+QUICK LISTS: length:      2  bytes:    208
+
+
+MALLOC 1 FROM QUICK LIST
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    608}
+  [  0] head @    312 {state: a  size:    200}  foot @    544 {size:    200}
+  [  1] head @    656 {state: a  size:    328}  foot @   1016 {size:    328}
+USED LIST: blocklist{length:      3  bytes:    312}
+  [  0] head @    208 {state: u  size:     64}  foot @    304 {size:     64}
+  [  1] head @    552 {state: u  size:     64}  foot @    648 {size:     64}
+  [  2] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+QUICK LISTS: length:      1  bytes:    104
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 240 from heap start
+ptr[ 2]: (nil)
+ptr[ 3]: (nil)
+ptr[ 4]: 584 from heap start
+
+FREE 0,4 OVERFLOWS
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      3  bytes:    816}
+  [  0] head @      0 {state: a  size:    168}  foot @    200 {size:    168}
+  [  1] head @    312 {state: a  size:    200}  foot @    544 {size:    200}
+  [  2] head @    656 {state: a  size:    328}  foot @   1016 {size:    328}
+USED LIST: blocklist{length:      1  bytes:    104}
+  [  0] head @    208 {state: u  size:     64}  foot @    304 {size:     64}
+QUICK LISTS: length:      1  bytes:    104
+
+
+FLUSH
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    920}
+  [  0] head @    312 {state: a  size:    672}  foot @   1016 {size:    672}
+  [  1] head @      0 {state: a  size:    168}  foot @    200 {size:    168}
+USED LIST: blocklist{length:      1  bytes:    104}
+  [  0] head @    208 {state: u  size:     64}  foot @    304 {size:     64}
+QUICK LISTS: length:      0  bytes:      0
+
+splits: 5  merges: 3  quick hits: 1  quick flushes: 2
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="heap_file"
+objects[T]="el_malloc_offset.o"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+#define EL_OFFSET_LINKS
+#include <sys/mman.h>
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+  char *path = "test-data/heap_file.heap";
+
+  el_cleanup();
+  remove(path);
+  printf("CREATE: %d\n", el_init_file(path, HEAP_SIZE));
+  ptr[len++] = el_malloc(128);
+  ptr[len++] = el_malloc(200);
+  ptr[len++] = el_malloc(64);
+  el_free(ptr[0]); ptr[0] = NULL;
+  strcpy(ptr[1], "saved in the file");
+  el_set_root(ptr[1]);
+  printf("\nMALLOC 0-2, FREE 0\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+
+  // hold the old address so the file has to map somewhere else
+  void *old = el_ctl.heap_start;
+  el_cleanup();
+  void *hold = mmap(old, 4096 + HEAP_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  printf("\nREOPEN: %d\n", el_init_file(path, 0));
+  printf("moved: %d\n", el_ctl.heap_start != old);
+  print_ptr_offset("root", el_get_root());
+  printf("root string: %s\n", (char *) el_get_root());
+  el_print_stats(); printf("\n");
+
+  ptr[0] = el_malloc(100);
+  printf("\nMALLOC 0\n"); el_print_stats(); printf("\n");
+  printf("check: %d\n", el_check_heap());
+
+  fflush(stdout);
+  el_cleanup();
+  printf("NOT A HEAP FILE: %d\n", el_init_file("test_el_malloc_data.sh", 0));
+  fflush(stdout);
+  printf("REOPEN: %d\n", el_init_file(path, 0));
+  munmap(hold, 4096 + HEAP_SIZE);
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+CREATE: 0
+
+MALLOC 0-2, FREE 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    680}
+  [  0] head @      0 {state: a  size:    128}  foot @    160 {size:    128}
+  [  1] head @    512 {state: a  size:    472}  foot @   1016 {size:    472}
+USED LIST: blocklist{length:      2  bytes:    344}
+  [  0] head @    408 {state: u  size:     64}  foot @    504 {size:     64}
+  [  1] head @    168 {state: u  size:    200}  foot @    400 {size:    200}
+
+POINTERS
+ptr[ 0]: (nil)
+ptr[ 1]: 200 from heap start
+ptr[ 2]: 440 from heap start
+
+REOPEN: 0
+moved: 1
+root: 200 from heap start
+root string: saved in the file
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    680}
+  [  0] head @      0 {state: a  size:    128}  foot @    160 {size:    128}
+  [  1] head @    512 {state: a  size:    472}  foot @   1016 {size:    472}
+USED LIST: blocklist{length:      2  bytes:    344}
+  [  0] head @    408 {state: u  size:     64}  foot @    504 {size:     64}
+  [  1] head @    168 {state: u  size:    200}  foot @    400 {size:    200}
+
+
+MALLOC 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    540}
+  [  0] head @    652 {state: a  size:    332}  foot @   1016 {size:    332}
+  [  1] head @      0 {state: a  size:    128}  foot @    160 {size:    128}
+USED LIST: blocklist{length:      3  bytes:    484}
+  [  0] head @    512 {state: u  size:    100}  foot @    644 {size:    100}
+  [  1] head @    408 {state: u  size:     64}  foot @    504 {size:     64}
+  [  2] head @    168 {state: u  size:    200}  foot @    400 {size:    200}
+
+check: 0
+el_init_file: test_el_malloc_data.sh is not a heap file for this build
+NOT A HEAP FILE: 1
+REOPEN: 0
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="arenas"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  ptr[len++] = el_malloc(100);
+  el_ctl_t *arena = el_arena_create(512);
+  ptr[len++] = el_arena_malloc(arena, 200);
+  ptr[len++] = el_arena_malloc(arena, 64);
+  printf("\nDEFAULT ARENA\n"); el_print_stats(); printf("\n");
+
+  el_ctl_t *prev = el_arena_use(arena);
+  printf("PREVIOUS IS DEFAULT: %d\n", prev == &el_default_ctl);
+  printf("\nNEW ARENA\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr+1, 2);
+
+  el_free(ptr[1]); ptr[1] = NULL;
+  el_reset();
+  printf("\nRESET\n"); el_print_stats(); printf("\n");
+
+  el_set_bump(1);
+  ptr[1] = el_malloc(64);
+  ptr[2] = el_malloc(64);
+  el_free(ptr[1]);
+  printf("\nBUMP FREE IGNORED\n"); el_print_stats(); printf("\n");
+  el_reset();
+  printf("\nBUMP RESET\n"); el_print_stats(); printf("\n");
+
+  el_arena_destroy(arena);
+  printf("BACK TO DEFAULT: %d\n", el_current == &el_default_ctl);
+  el_free(ptr[0]);
+  printf("\nDEFAULT FREE\n"); el_print_stats(); printf("\n");
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+DEFAULT ARENA
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    884}
+  [  0] head @    140 {state: a  size:    844}  foot @   1016 {size:    844}
+USED LIST: blocklist{length:      1  bytes:    140}
+  [  0] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+
+PREVIOUS IS DEFAULT: 1
+
+NEW ARENA
+HEAP STATS
+Heap bytes: 512
+AVAILABLE LIST: blocklist{length:      1  bytes:    168}
+  [  0] head @    344 {state: a  size:    128}  foot @    504 {size:    128}
+USED LIST: blocklist{length:      2  bytes:    344}
+  [  0] head @    240 {state: u  size:     64}  foot @    336 {size:     64}
+  [  1] head @      0 {state: u  size:    200}  foot @    232 {size:    200}
+
+POINTERS
+ptr[ 0]: 32 from heap start
+ptr[ 1]: 272 from heap start
+
+RESET
+HEAP STATS
+Heap bytes: 512
+AVAILABLE LIST: blocklist{length:      1  bytes:    512}
+  [  0] head @      0 {state: a  size:    472}  foot @    504 {size:    472}
+USED LIST: blocklist{length:      0  bytes:      0}
+
+
+BUMP FREE IGNORED
+HEAP STATS
+Heap bytes: 512
+AVAILABLE LIST: blocklist{length:      1  bytes:    304}
+  [  0] head @    208 {state: a  size:    264}  foot @    504 {size:    264}
+USED LIST: blocklist{length:      2  bytes:    208}
+  [  0] head @    104 {state: u  size:     64}  foot @    200 {size:     64}
+  [  1] head @      0 {state: u  size:     64}  foot @     96 {size:     64}
+
+
+BUMP RESET
+HEAP STATS
+Heap bytes: 512
+AVAILABLE LIST: blocklist{length:      1  bytes:    512}
+  [  0] head @      0 {state: a  size:    472}  foot @    504 {size:    472}
+USED LIST: blocklist{length:      0  bytes:      0}
+
+BACK TO DEFAULT: 1
+
+DEFAULT FREE
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1024}
+  [  0] head @      0 {state: a  size:    984}  foot @   1016 {size:    984}
+USED LIST: blocklist{length:      0  bytes:      0}
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="mmap_huge"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  el_stats_t stats;
+  char *big = el_malloc(200000);
+  char *small = el_malloc(100);
+  printf("\nMALLOC HUGE AND SMALL\n"); el_print_stats(); printf("\n");
+  printf("huge outside heap: %d\n", (void *) big < el_ctl.heap_start || (void *) big >= el_ctl.heap_end);
+  printf("small offset: %lu\n", PTR_MINUS_PTR(small, el_ctl.heap_start));
+
+  memset(big, 'x', 200000);
+  big = el_realloc(big, 500000);
+  printf("kept after grow: %d\n", big[0] == 'x' && big[199999] == 'x');
+  char *zero = el_calloc(1000, 1000);
+  printf("calloc zeroed: %d\n", zero[0] == 0 && zero[999999] == 0);
+
+  el_get_stats(&stats);
+  printf("mmaps: %lu  blocks: %lu  threshold: %lu\n",
+         stats.mmaps, stats.mmap_blocks, stats.mmap_threshold);
+  el_free(zero);
+  el_get_stats(&stats);
+  printf("threshold raised past freed block: %d\n", stats.mmap_threshold > 1000000);
+
+  // under the raised threshold but too big for the heap
+  char *next = el_malloc(300000);
+  printf("fallback mapped: %d\n", next != NULL);
+  el_free(next);
+
+  el_set_mmap_threshold(0);
+  printf("off: %p\n", el_malloc(300000));
+  el_free(big);
+  el_free(small);
+  printf("\nFREE ALL\n"); el_print_stats(); printf("\n");
+  el_get_stats(&stats);
+  printf("allocs: %lu  frees: %lu  failed: %lu\n", stats.allocs, stats.frees, stats.failed);
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+MALLOC HUGE AND SMALL
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    884}
+  [  0] head @    140 {state: a  size:    844}  foot @   1016 {size:    844}
+USED LIST: blocklist{length:      1  bytes:    140}
+  [  0] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+MMAPPED: length:      1  bytes: 200704
+
+huge outside heap: 1
+small offset: 32
+kept after grow: 1
+calloc zeroed: 1
+mmaps: 2  blocks: 2  threshold: 131072
+threshold raised past freed block: 1
+fallback mapped: 1
+off: (nil)
+
+FREE ALL
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1024}
+  [  0] head @      0 {state: a  size:    984}  foot @   1016 {size:    984}
+USED LIST: blocklist{length:      0  bytes:      0}
+
+allocs: 4  frees: 4  failed: 1
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="aligned_alloc"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+void run_test(){
+  void *ptr[16] = {};
+  int len = 0;
+
+  // a heap at a known alignment so offsets are the same every run
+  el_cleanup();
+  void *heap = aligned_alloc(256, HEAP_SIZE);
+  memset(heap, 0, HEAP_SIZE);
+  el_init_heap(heap, HEAP_SIZE);
+
+  ptr[len++] = el_aligned_alloc(64, 100);
+  printf("\nALIGNED 64, SLACK BELOW SPLIT OFF\n"); el_print_stats(); printf("\n");
+  ptr[len++] = el_malloc(20);
+  ptr[len++] = el_aligned_alloc(256, 64);
+  ptr[len++] = el_aligned_alloc(8, 10);
+  printf("\nMORE ALLOCATIONS\n"); el_print_stats(); printf("\n");
+  printf("POINTERS\n"); print_ptrs(ptr, len);
+  for(int i=0; i<len; i++){
+    printf("ptr[%2d] mod 64: %lu\n", i, PTR_MINUS_PTR(ptr[i], heap) % 64);
+  }
+
+  printf("bad alignment: %p\n", el_aligned_alloc(48, 10));
+  printf("no room: %p\n", el_aligned_alloc(512, 600));
+
+  for(int i=0; i<len; i++){
+    el_free(ptr[i]);
+  }
+  printf("\nFREE ALL\n"); el_print_stats(); printf("\n");
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+
+ALIGNED 64, SLACK BELOW SPLIT OFF
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    884}
+  [  0] head @    236 {state: a  size:    748}  foot @   1016 {size:    748}
+  [  1] head @      0 {state: a  size:     56}  foot @     88 {size:     56}
+USED LIST: blocklist{length:      1  bytes:    140}
+  [  0] head @     96 {state: u  size:    100}  foot @    228 {size:    100}
+
+
+MORE ALLOCATIONS
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      3  bytes:    670}
+  [  0] head @    634 {state: a  size:    350}  foot @   1016 {size:    350}
+  [  1] head @    296 {state: a  size:    144}  foot @    472 {size:    144}
+  [  2] head @      0 {state: a  size:     56}  foot @     88 {size:     56}
+USED LIST: blocklist{length:      4  bytes:    354}
+  [  0] head @    584 {state: u  size:     10}  foot @    626 {size:     10}
+  [  1] head @    480 {state: u  size:     64}  foot @    576 {size:     64}
+  [  2] head @    236 {state: u  size:     20}  foot @    288 {size:     20}
+  [  3] head @     96 {state: u  size:    100}  foot @    228 {size:    100}
+
+POINTERS
+ptr[ 0]: 128 from heap start
+ptr[ 1]: 268 from heap start
+ptr[ 2]: 512 from heap start
+ptr[ 3]: 616 from heap start
+ptr[ 0] mod 64: 0
+ptr[ 1] mod 64: 12
+ptr[ 2] mod 64: 0
+ptr[ 3] mod 64: 40
+bad alignment: (nil)
+no room: (nil)
+
+FREE ALL
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1024}
+  [  0] head @      0 {state: a  size:    984}  foot @   1016 {size:    984}
+USED LIST: blocklist{length:      0  bytes:      0}
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="arena_threads"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+#include <pthread.h>
+#define NTHREADS 4
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+typedef struct {
+  el_ctl_t *arena;
+  int id;
+  int mismatches;
+} worker_t;
+
+// Churn through blocks in an arena of the worker's own; the current
+// arena is per thread so workers do not see each other's.
+void *work(void *arg){
+  worker_t *w = arg;
+  char *ptr[8] = {};
+  el_arena_use(w->arena);
+  for(int round=0; round<2000; round++){
+    int i = round % 8;
+    if(ptr[i] != NULL){
+      if(ptr[i][0] != (char) (w->id + i)){
+        w->mismatches++;
+      }
+      el_free(ptr[i]);
+    }
+    ptr[i] = el_malloc(16 + (round * 7 + w->id * 13) % 200);
+    ptr[i][0] = w->id + i;
+  }
+  for(int i=0; i<8; i++){
+    el_free(ptr[i]);
+  }
+  return NULL;
+}
+
+void run_test(){
+  pthread_t threads[NTHREADS];
+  worker_t workers[NTHREADS];
+  for(int t=0; t<NTHREADS; t++){
+    workers[t].arena = el_arena_create(4096);
+    workers[t].id = t;
+    workers[t].mismatches = 0;
+  }
+  for(int t=0; t<NTHREADS; t++){
+    pthread_create(&threads[t], NULL, work, &workers[t]);
+  }
+  void *ptr = el_malloc(100);
+  for(int t=0; t<NTHREADS; t++){
+    pthread_join(threads[t], NULL);
+  }
+  printf("MAIN STILL DEFAULT: %d\n", el_current == &el_default_ctl);
+
+  for(int t=0; t<NTHREADS; t++){
+    el_ctl_t *prev = el_arena_use(workers[t].arena);
+    printf("ARENA %d: mismatches %d  check %d  used %lu  avail %lu  bytes %lu\n",
+           t, workers[t].mismatches, el_check_heap(), el_ctl.used->length,
+           el_ctl.avail->length, el_ctl.avail->bytes);
+    el_arena_use(prev);
+    el_arena_destroy(workers[t].arena);
+  }
+  el_free(ptr);
+  printf("\nDEFAULT\n"); el_print_stats(); printf("\n");
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+MAIN STILL DEFAULT: 1
+ARENA 0: mismatches 0  check 0  used 0  avail 1  bytes 4096
+ARENA 1: mismatches 0  check 0  used 0  avail 1  bytes 4096
+ARENA 2: mismatches 0  check 0  used 0  avail 1  bytes 4096
+ARENA 3: mismatches 0  check 0  used 0  avail 1  bytes 4096
+
+DEFAULT
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:   1024}
+  [  0] head @      0 {state: a  size:    984}  foot @   1016 {size:    984}
+USED LIST: blocklist{length:      0  bytes:      0}
+ENDOUT
+
+################################################################################
+((T++))
+tnames[T]="heap_file_crash"
+objects[T]="el_malloc_offset.o"
+#
+read  -r -d '' defines[$T] <<"ENDDEF"
+#define HEAP_SIZE 1024
+#define EL_OFFSET_LINKS
+#include <unistd.h>
+#include <sys/wait.h>
+ENDDEF
+#
+read  -r -d '' cfile[$T] <<"ENDCFILE"
+// Run fill() on a new heap file in a child that exits without
+// el_cleanup() as if it had crashed.
+void crash_after(char *path, void (*fill)()){
+  fflush(stdout);
+  pid_t pid = fork();
+  if(pid == 0){
+    el_init_file(path, HEAP_SIZE);
+    fill();
+    _exit(0);
+  }
+  waitpid(pid, NULL, 0);
+}
+
+void fill_and_dirty(){
+  char *saved = el_malloc(100);
+  strcpy(saved, "survived a crash");
+  el_set_root(saved);
+  char *junk = el_malloc(64);
+  memset(junk, 'x', 64);
+  el_free(junk);
+}
+
+void fill_and_reset(){
+  fill_and_dirty();
+  el_reset();
+}
+
+// Leave freed blocks on quick lists, which only el_ctl knows about.
+void fill_quick(){
+  el_set_quick_limits(256, 8);
+  void *ptr[4];
+  for(int i=0; i<4; i++){
+    ptr[i] = el_malloc(32 + 32*i);
+  }
+  el_free(ptr[1]);
+  el_free(ptr[3]);
+}
+
+void fill_quick_unlinked(){
+  el_set_used_links(0);
+  fill_quick();
+}
+
+void run_test(){
+  char *path = "test-data/heap_file.heap";
+
+  el_cleanup();
+  remove(path);
+  crash_after(path, fill_and_dirty);
+  fflush(stdout);
+  printf("REOPEN: %d\n", el_init_file(path, 0));
+  print_ptr_offset("root", el_get_root());
+  printf("root string: %s\n", (char *) el_get_root());
+  printf("allocs since reopen: %lu\n", el_ctl.stats.allocs);
+  char *zeroed = el_calloc(8, 8);
+  int dirty = 0;
+  for(int i=0; i<64; i++){
+    dirty += zeroed[i] != 0;
+  }
+  printf("calloc dirty bytes: %d\n", dirty);
+  el_print_stats(); printf("\n");
+  printf("check: %d\n", el_check_heap());
+
+  // el_reset() clears the saved root
+  el_cleanup();
+  remove(path);
+  crash_after(path, fill_and_reset);
+  fflush(stdout);
+  printf("\nRESET REOPEN: %d\n", el_init_file(path, 0));
+  printf("root: %p\n", el_get_root());
+  printf("check: %d\n", el_check_heap());
+
+  // blocks left on quick lists are released
+  el_cleanup();
+  remove(path);
+  crash_after(path, fill_quick);
+  fflush(stdout);
+  printf("\nQUICK LISTS REOPEN: %d\n", el_init_file(path, 0));
+  el_print_stats(); printf("\n");
+  printf("check: %d\n", el_check_heap());
+
+  // also when in-use blocks are only counted
+  el_cleanup();
+  remove(path);
+  crash_after(path, fill_quick_unlinked);
+  fflush(stdout);
+  printf("\nUNLINKED QUICK LISTS REOPEN: %d\n", el_init_file(path, 0));
+  el_print_stats(); printf("\n");
+  printf("check: %d\n", el_check_heap());
+}
+ENDCFILE
+#
+read  -r -d '' output[$T] <<"ENDOUT"
+el_init_file: test-data/heap_file.heap was not closed cleanly, checking it
+REOPEN: 0
+root: 32 from heap start
+root string: survived a crash
+allocs since reopen: 0
+calloc dirty bytes: 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      1  bytes:    780}
+  [  0] head @    244 {state: a  size:    740}  foot @   1016 {size:    740}
+USED LIST: blocklist{length:      2  bytes:    244}
+  [  0] head @    140 {state: u  size:     64}  foot @    236 {size:     64}
+  [  1] head @      0 {state: u  size:    100}  foot @    132 {size:    100}
+
+check: 0
+el_init_file: test-data/heap_file.heap was not closed cleanly, checking it
+
+RESET REOPEN: 0
+root: (nil)
+check: 0
+el_init_file: test-data/heap_file.heap was not closed cleanly, checking it
+
+QUICK LISTS REOPEN: 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    816}
+  [  0] head @    312 {state: a  size:    672}  foot @   1016 {size:    672}
+  [  1] head @     72 {state: a  size:     64}  foot @    168 {size:     64}
+USED LIST: blocklist{length:      2  bytes:    208}
+  [  0] head @    176 {state: u  size:     96}  foot @    304 {size:     96}
+  [  1] head @      0 {state: u  size:     32}  foot @     64 {size:     32}
+
+check: 0
+el_init_file: test-data/heap_file.heap was not closed cleanly, checking it
+
+UNLINKED QUICK LISTS REOPEN: 0
+HEAP STATS
+Heap bytes: 1024
+AVAILABLE LIST: blocklist{length:      2  bytes:    816}
+  [  0] head @    312 {state: a  size:    672}  foot @   1016 {size:    672}
+  [  1] head @     72 {state: a  size:     64}  foot @    168 {size:     64}
+USED LIST: blocklist{length:      2  bytes:    208}
+  [  0] head @      0 {state: u  size:     32}  foot @     64 {size:     32}
+  [  1] head @    176 {state: u  size:     96}  foot @    304 {size:     96}
+
+check: 0
+ENDOUT